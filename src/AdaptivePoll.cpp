@@ -0,0 +1,66 @@
+/*
+ * AdaptivePoll.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include "AdaptivePoll.h"
+#include <vector>
+#include <algorithm>
+
+static std::vector<const AdaptivePoll*>& pollers()
+{
+	static std::vector<const AdaptivePoll*> p;
+	return p;
+}
+
+AdaptivePoll::AdaptivePoll(const Tasks::Task* owner, uint16_t minInterval, uint16_t maxInterval):
+	owner(owner),
+	minInterval(minInterval),
+	maxInterval(maxInterval),
+	interval(minInterval)
+{
+	pollers().push_back(this);
+}
+
+AdaptivePoll::~AdaptivePoll()
+{
+	auto& p = pollers();
+	p.erase(std::remove(p.begin(), p.end(), this), p.end());
+}
+
+uint16_t AdaptivePoll::next(bool activity)
+{
+	uint32_t now = millis();
+
+	if (activity)
+	{
+		//the first input after being idle - it may have arrived right after the previous poll
+		if (!active)
+		{
+			uint32_t gap = now - lastPoll;
+			gapAvg = gapAvg ? (gapAvg * 7 + gap) / 8: gap;
+			gapMax = std::max(gapMax, gap);
+		}
+		interval = minInterval;
+	}
+	else
+	{
+		interval = std::min<uint32_t>(interval * 2, maxInterval);
+	}
+
+	active = activity;
+	lastPoll = now;
+	return interval;
+}
+
+const AdaptivePoll* AdaptivePoll::find(const Tasks::Task* owner)
+{
+	for (auto p: pollers())
+	{
+		if (p->owner == owner)
+			return p;
+	}
+	return nullptr;
+}
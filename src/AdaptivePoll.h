@@ -0,0 +1,47 @@
+/*
+ * AdaptivePoll.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef ADAPTIVEPOLL_H_
+#define ADAPTIVEPOLL_H_
+
+#include <tasks.hpp>
+#include "Arduino.h"
+
+//Poll interval of a task that has to check for input: the minimum right after
+//some activity, doubled on every idle poll up to the maximum. The input found
+//after an idle period waited at most the gap since the previous poll - the gaps
+//are recorded as the upper bound of the latency added by backing off (the time
+//the input arrived can't be seen, it's read only when polled).
+class AdaptivePoll
+{
+	public:
+		AdaptivePoll(const Tasks::Task* owner, uint16_t minInterval, uint16_t maxInterval);
+		~AdaptivePoll();
+
+		//call on every poll, returns the ms till the next one
+		uint16_t next(bool activity);
+
+		uint16_t getInterval() const {return interval;}
+		uint32_t getGapAvg() const {return gapAvg;}
+		uint32_t getGapMax() const {return gapMax;}
+
+		//the poller of the task, nullptr if it has none
+		static const AdaptivePoll* find(const Tasks::Task* owner);
+
+	private:
+		const Tasks::Task* owner;
+		uint16_t minInterval;
+		uint16_t maxInterval;
+		uint16_t interval;
+
+		bool active = true;
+		uint32_t lastPoll = 0;		//millis()
+		uint32_t gapAvg = 0;		//ms, EWMA
+		uint32_t gapMax = 0;
+};
+
+#endif /* ADAPTIVEPOLL_H_ */
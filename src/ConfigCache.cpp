@@ -0,0 +1,195 @@
+/*
+ * ConfigCache.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include "ConfigCache.h"
+#include "LittleFS.h"
+#include "utils.h"
+#include <memory>
+#include <vector>
+
+static const char textFile[] = "/config.txt";
+static const char imageFile[] = "/config.bin";
+
+//"ICF1"
+const static uint32_t IMAGE_MAGIC = 0x31464349;
+
+struct ImageHeader
+{
+	uint32_t magic;
+	uint32_t textSize;
+	uint32_t textTime;		//getLastWrite() of the text
+	uint32_t payloadSize;
+	uint32_t checksum;		//FNV-1a of the payload
+	uint16_t count;
+};
+
+//every value in the payload: the hash of the key (uint32_t), the lengths of
+//the key (uint8_t) and the value (uint16_t), the key and the value with their
+//zeros - unaligned, read with memcpy
+const static size_t RECORD_HEADER = 7;
+
+static uint32_t checksum(const uint8_t* p, size_t size)
+{
+	uint32_t h = 2166136261u;
+	while (size--)
+		h = (h ^ *p++) * 16777619u;
+	return h;
+}
+
+static bool readImage(fs::File& text, const ConfigCache::ValueCallback& callback)
+{
+	auto file = LittleFS.open(imageFile, "r");
+	if (!file)
+		return false;
+
+	size_t size = file.size();
+	if (size < sizeof(ImageHeader))
+	{
+		file.close();
+		return false;
+	}
+
+	std::unique_ptr<uint8_t[]> image(new uint8_t[size]);
+	bool ok = file.read(image.get(), size) == size;
+	file.close();
+
+	ImageHeader h;
+	memcpy(&h, image.get(), sizeof(h));
+
+	const uint8_t* p = image.get() + sizeof(h);
+	const uint8_t* end = image.get() + size;
+
+	if (!ok || h.magic != IMAGE_MAGIC ||
+			h.textSize != text.size() || h.textTime != (uint32_t)text.getLastWrite() ||
+			h.payloadSize != size - sizeof(h) || h.checksum != checksum(p, h.payloadSize))
+		return false;
+
+	for (uint16_t i = 0; i < h.count; ++i)
+	{
+		if (p + RECORD_HEADER > end)
+			return false;
+
+		uint32_t hash;
+		uint16_t valueLength;
+		memcpy(&hash, p, sizeof(hash));
+		uint8_t keyLength = p[4];
+		memcpy(&valueLength, p + 5, sizeof(valueLength));
+
+		const char* key = (const char*)p + RECORD_HEADER;
+		const char* value = key + keyLength + 1;
+		p = (const uint8_t*)value + valueLength + 1;
+		if (p > end)
+			return false;
+
+		callback(DataStore::Key(key, hash), value);
+	}
+
+	return true;
+}
+
+static void append(std::vector<uint8_t>& payload, const void* data, size_t size)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	payload.insert(payload.end(), p, p + size);
+}
+
+//reads the text in blocks, the values go to the callback and to the new image
+static void parseText(fs::File& text, const ConfigCache::ValueCallback& callback)
+{
+	std::vector<uint8_t> payload;
+	uint16_t count = 0;
+	bool complete = true;
+	String line;
+
+	auto addLine = [&]()
+	{
+		auto p = splitLine(line);
+		line = String();
+		if (not p.second.length())
+			return;
+
+		DataStore::Key key(p.first);
+		callback(key, p.second.c_str());
+
+		//the record can't hold it, the text is parsed at every start then
+		if (p.first.length() > UINT8_MAX || p.second.length() > UINT16_MAX)
+		{
+			complete = false;
+			return;
+		}
+
+		uint8_t keyLength = p.first.length();
+		uint16_t valueLength = p.second.length();
+		append(payload, &key.hash, sizeof(key.hash));
+		append(payload, &keyLength, sizeof(keyLength));
+		append(payload, &valueLength, sizeof(valueLength));
+		append(payload, p.first.c_str(), keyLength + 1);
+		append(payload, p.second.c_str(), valueLength + 1);
+		count++;
+	};
+
+	uint8_t buffer[128];
+	while (size_t n = text.read(buffer, sizeof(buffer)))
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			char c = buffer[i];
+			if (c == '\n' || c == '\r')
+				addLine();
+			else
+				line += c;
+		}
+	}
+	addLine();
+
+	if (!complete)
+	{
+		logPrintfX(F("CFG"), F("A key is too long for the image, it's not written"));
+		LittleFS.remove(imageFile);
+		return;
+	}
+
+	ImageHeader h = {IMAGE_MAGIC, (uint32_t)text.size(), (uint32_t)text.getLastWrite(),
+			(uint32_t)payload.size(), checksum(payload.data(), payload.size()), count};
+
+	auto file = LittleFS.open(imageFile, "w");
+	if (!file)
+		return;
+
+	file.write((const uint8_t*)&h, sizeof(h));
+	file.write(payload.data(), payload.size());
+	file.close();
+}
+
+ConfigCache::Source ConfigCache::read(ValueCallback callback)
+{
+	Source source = Source::NONE;
+
+	LittleFS.begin();
+	auto text = LittleFS.open(textFile, "r");
+	if (text)
+	{
+		source = Source::IMAGE;
+		if (!readImage(text, callback))
+		{
+			logPrintfX(F("CFG"), F("The image is missing or out of date, parsing the text..."));
+			parseText(text, callback);
+			source = Source::TEXT;
+		}
+		text.close();
+	}
+	LittleFS.end();
+
+	return source;
+}
+
+void ConfigCache::invalidate()
+{
+	LittleFS.begin();
+	LittleFS.remove(imageFile);
+	LittleFS.end();
+}
@@ -0,0 +1,32 @@
+/*
+ * ConfigCache.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef CONFIGCACHE_H_
+#define CONFIGCACHE_H_
+
+#include "Arduino.h"
+#include "DataStore.h"
+#include <functional>
+
+//The /config.txt compiled into /config.bin: the keys with their hashes and
+//the values, all read with one read at the start. The text is parsed again only
+//when its size or modification time differ from the ones the image was made
+//from, or when the image was removed by the code writing the text.
+namespace ConfigCache
+{
+	enum class Source: uint8_t {NONE, IMAGE, TEXT};
+
+	using ValueCallback = std::function<void(const DataStore::Key& key, const char* value)>;
+
+	//calls the callback for every value in the order of the file
+	Source read(ValueCallback callback);
+
+	//the text is going to change
+	void invalidate();
+}
+
+#endif /* CONFIGCACHE_H_ */
@@ -0,0 +1,207 @@
+/*
+ * ConfigJournal.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include "ConfigJournal.h"
+#include "ConfigCache.h"
+#include "DataStore.h"
+#include "LittleFS.h"
+#include "utils.h"
+#include "config.h"
+#include <vector>
+#include <algorithm>
+
+static const char textFile[] = "/config.txt";
+static const char tempFile[] = "/config.tmp";
+static const char journalFile[] = "/config.jnl";
+
+//the complete lines of the file, a line cut by a power loss has no end; the
+//last line of the text doesn't have to end with a new line (keepLast)
+static void forEachLine(fs::File& file, std::function<void(String& line)> callback, bool keepLast = false)
+{
+	String line;
+	uint8_t buffer[128];
+
+	while (size_t n = file.read(buffer, sizeof(buffer)))
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			char c = buffer[i];
+			if (c == '\r')
+				continue;
+
+			if (c != '\n')
+			{
+				line += c;
+				continue;
+			}
+
+			callback(line);
+			line = String();
+		}
+	}
+
+	if (keepLast && line.length())
+		callback(line);
+}
+
+static bool validKey(const String& key)
+{
+	return key.length() && key.indexOf('=') == -1 && key.indexOf('\n') == -1 && key.indexOf('\r') == -1 && key[0] != '#';
+}
+
+bool ConfigJournal::set(const String& key, const String& value)
+{
+	if (!validKey(key) || value.indexOf('\n') != -1 || value.indexOf('\r') != -1)
+		return false;
+
+	String line = key;
+	if (value.length())
+	{
+		line += '=';
+		line += value;
+	}
+	line += '\n';
+
+	LittleFS.begin();
+	auto file = LittleFS.open(journalFile, "a");
+	bool ok = static_cast<bool>(file);
+	size_t size = 0;
+	if (ok)
+	{
+		ok = file.print(line) == line.length();
+		size = file.size();
+		file.close();
+	}
+	LittleFS.end();
+
+	if (!ok)
+	{
+		logPrintfX(F("CFG"), F("Can't write the journal!"));
+		return false;
+	}
+
+	//the value itself is not logged, it can be a password
+	logPrintfX(F("CFG"), F("%s %s, journal %zu B"), key.c_str(), value.length() ? "set": "removed", size);
+
+	if (value.length())
+		DataStore::set(key, value);
+	else
+		DataStore::erase(key);
+
+	if (size > CONFIG_JOURNAL_MAX)
+		compact();
+
+	return true;
+}
+
+void ConfigJournal::replay(std::function<void(const String& key, const String& value)> callback)
+{
+	LittleFS.begin();
+	auto file = LittleFS.open(journalFile, "r");
+	if (file)
+	{
+		forEachLine(file, [&callback](String& line)
+		{
+			auto p = splitLine(line);
+			if (validKey(p.first))
+				callback(p.first, p.second);
+		});
+		file.close();
+	}
+	LittleFS.end();
+}
+
+bool ConfigJournal::compact()
+{
+	struct Change
+	{
+		String key;
+		String value;
+		bool written;
+	};
+
+	//the last change of every key
+	std::vector<Change> changes;
+	replay([&changes](const String& key, const String& value)
+	{
+		auto it = std::find_if(changes.begin(), changes.end(), [&key](const Change& c) {return c.key == key;});
+		if (it == changes.end())
+			changes.push_back(Change{key, value, false});
+		else
+			it->value = value;
+	});
+
+	if (changes.empty())
+		return true;
+
+	//the image is made from the text again at the next start
+	ConfigCache::invalidate();
+
+	LittleFS.begin();
+	auto out = LittleFS.open(tempFile, "w");
+	if (!out)
+	{
+		LittleFS.end();
+		return false;
+	}
+
+	//the lines stay where they are, with the comments around them; every line
+	//is counted, a short write leaves the text and the journal as they were
+	size_t expected = 0;
+	size_t written = 0;
+	auto print = [&out, &expected, &written](const String& s)
+	{
+		expected += s.length();
+		written += out.print(s);
+	};
+
+	auto base = LittleFS.open(textFile, "r");
+	if (base)
+	{
+		forEachLine(base, [&changes, &print](String& line)
+		{
+			String copy = line;
+			auto p = splitLine(copy);
+			auto it = std::find_if(changes.begin(), changes.end(), [&p](const Change& c) {return c.key == p.first;});
+			if (p.second.length() == 0 || it == changes.end())
+			{
+				print(line + "\n");
+				return;
+			}
+
+			//a key repeated in the file is written once
+			if (!it->written && it->value.length())
+				print(it->key + "=" + it->value + "\n");
+			it->written = true;
+		}, true);
+		base.close();
+	}
+
+	for (const auto& c: changes)
+	{
+		if (!c.written && c.value.length())
+			print(c.key + "=" + c.value + "\n");
+	}
+	out.close();
+
+	bool ok = written == expected && LittleFS.rename(tempFile, textFile);
+	if (ok)
+		LittleFS.remove(journalFile);
+	else
+		LittleFS.remove(tempFile);
+	LittleFS.end();
+
+	logPrintfX(F("CFG"), F("%zu change(s) merged into the config: %s"), changes.size(), ok ? "OK": "failed");
+	return ok;
+}
+
+void ConfigJournal::clear()
+{
+	LittleFS.begin();
+	LittleFS.remove(journalFile);
+	LittleFS.end();
+}
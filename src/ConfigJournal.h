@@ -0,0 +1,36 @@
+/*
+ * ConfigJournal.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef CONFIGJOURNAL_H_
+#define CONFIGJOURNAL_H_
+
+#include "Arduino.h"
+#include <functional>
+
+//Single values changed at run time: every change is one line appended to the
+//journal - /config.jnl ("key=value", just "key" removes it) and applied to the
+//DataStore at once. The lines are merged into /config.txt when the journal grows over
+//CONFIG_JOURNAL_MAX - written to a temporary file that replaces the text with a
+//rename. LittleFS keeps the old contents of a file till it's closed, so a power
+//loss leaves either the old or the new line, and the journal is removed only
+//after the rename (applying it again to the merged text changes nothing).
+namespace ConfigJournal
+{
+	//an empty value removes the key, false if it couldn't be stored
+	bool set(const String& key, const String& value);
+
+	//the changes since the last merge in the order they were made (an empty value - removed)
+	void replay(std::function<void(const String& key, const String& value)> callback);
+
+	//merges the journal into /config.txt
+	bool compact();
+
+	//the text was replaced as a whole, the changes are gone
+	void clear();
+}
+
+#endif /* CONFIGJOURNAL_H_ */
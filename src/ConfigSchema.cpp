@@ -0,0 +1,174 @@
+/*
+ * ConfigSchema.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include "ConfigSchema.h"
+#include "DataStore.h"
+#include "utils.h"
+
+using namespace Config;
+
+struct Schema
+{
+	const char* key;
+	const char* def;
+	const char* owner;
+	Type type;
+	float min;
+	float max;
+};
+
+//the strings of the table in the flash as well
+#define CONFIG_FIELD_STRINGS(id, key, type, def, min, max, owner) \
+	static const char id##_key[] PROGMEM = key; \
+	static const char id##_def[] PROGMEM = def; \
+	static const char id##_owner[] PROGMEM = owner;
+CONFIG_FIELDS(CONFIG_FIELD_STRINGS)
+
+#define CONFIG_FIELD_SCHEMA(id, key, type, def, min, max, owner) \
+	{id##_key, id##_def, id##_owner, Type::type, min, max},
+static const Schema schema[] PROGMEM = {CONFIG_FIELDS(CONFIG_FIELD_SCHEMA)};
+
+union Value
+{
+	int32_t i;
+	float f;
+};
+
+static Value values[FIELD_COUNT];
+
+static String errors[FIELD_COUNT];
+
+static Schema readSchema(Field f)
+{
+	Schema s;
+	memcpy_P(&s, &schema[f], sizeof(s));
+	return s;
+}
+
+//the whole text has to be the number, toInt() and toFloat() accept "5 min" or "abc"
+static bool parse(const Schema& s, const String& text, Value& v)
+{
+	const char* begin = text.c_str();
+	char* end;
+
+	switch (s.type)
+	{
+		case Type::INT:
+		case Type::BOOL:
+		{
+			long l = strtol(begin, &end, 10);
+			v.i = l;
+			if (end == begin || *end || l < s.min || l > s.max)
+				return false;
+			return true;
+		}
+
+		case Type::FLOAT:
+			v.f = strtod(begin, &end);
+			return end != begin && !*end && v.f >= s.min && v.f <= s.max;
+	}
+
+	return false;
+}
+
+static const char* typeName(Type t)
+{
+	switch (t)
+	{
+		case Type::INT: return "an integer";
+		case Type::FLOAT: return "a number";
+		case Type::BOOL: return "0 or 1";
+	}
+	return "";
+}
+
+static void loadField(Field f)
+{
+	Schema s = readSchema(f);
+	String def = FPSTR(s.def);
+	errors[f] = String();
+
+	if (!DataStore::hasValue(FPSTR(s.key)))
+	{
+		parse(s, def, values[f]);
+		return;
+	}
+
+	String text = DataStore::value(FPSTR(s.key));
+	text.trim();
+	if (parse(s, text, values[f]))
+		return;
+
+	char line[128];
+	if (s.type == Type::BOOL)
+		snprintf_P(line, sizeof(line), PSTR("%s: '%s' is not %s, using %s"),
+				String(FPSTR(s.key)).c_str(), text.c_str(), typeName(s.type), def.c_str());
+	else
+		snprintf_P(line, sizeof(line), PSTR("%s: '%s' is not %s in [%ld, %ld], using %s"),
+				String(FPSTR(s.key)).c_str(), text.c_str(), typeName(s.type), (long)s.min, (long)s.max, def.c_str());
+
+	logPrintfX(F("CFG"), "%s", line);
+	errors[f] = line;
+	parse(s, def, values[f]);
+}
+
+void Config::load()
+{
+	static bool subscribed = false;
+	if (!subscribed)
+	{
+		//the first subscriber - the typed value is up to date when the others are called
+		DataStore::subscribe(String(), [](const String& key)
+		{
+			for (uint8_t i = 0; i < FIELD_COUNT; ++i)
+			{
+				if (strcmp_P(key.c_str(), readSchema((Field)i).key) == 0)
+					loadField((Field)i);
+			}
+		});
+		subscribed = true;
+	}
+
+	for (uint8_t i = 0; i < FIELD_COUNT; ++i)
+		loadField((Field)i);
+}
+
+int32_t Config::getInt(Field f)
+{
+	return values[f].i;
+}
+
+float Config::getFloat(Field f)
+{
+	return values[f].f;
+}
+
+bool Config::getBool(Field f)
+{
+	return values[f].i;
+}
+
+String Config::getKey(Field f)
+{
+	return FPSTR(readSchema(f).key);
+}
+
+String Config::getOwner(Field f)
+{
+	return FPSTR(readSchema(f).owner);
+}
+
+std::vector<String> Config::getErrors()
+{
+	std::vector<String> result;
+	for (const auto& e: errors)
+	{
+		if (e.length())
+			result.push_back(e);
+	}
+	return result;
+}
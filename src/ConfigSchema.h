@@ -0,0 +1,60 @@
+/*
+ * ConfigSchema.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef CONFIGSCHEMA_H_
+#define CONFIGSCHEMA_H_
+
+#include "Arduino.h"
+#include <vector>
+
+//The configuration values with a known type: parsed and checked once when the
+//configuration is loaded, read with the typed getters afterwards. A missing or
+//invalid value gives the default, the invalid ones are listed on the config page.
+//The other keys (texts, the *Enabled flags, messages.N...) stay in the DataStore only.
+namespace Config
+{
+	enum class Type: uint8_t {INT, FLOAT, BOOL};
+
+	//   id             key                 type   default  min  max     owner (task name)
+	#define CONFIG_FIELDS(X) \
+		X(SEGMENTS,         "segments",         INT,   "8",     1,   32,     "display") \
+		X(ROTATION,         "rotation",         INT,   "0",     0,   3,      "display") \
+		X(BRIGHTNESS,       "brightness",       INT,   "0",     0,   15,     "display") \
+		X(SCROLL_SPEED,     "scrollSpeed",      FLOAT, "0",     0,   1000,   "display") \
+		X(SCROLL_DWELL,     "scrollDwell",      FLOAT, "0.2",   0,   60,     "display") \
+		X(DISPLAY_CYCLE,    "displayCycle",     INT,   "0",     0,   3600,   "display") \
+		X(OWM_PERIOD,       "owmPeriod",        INT,   "600",   60,  86400,  "owm") \
+		X(RESTAURANT,       "restaurant",       INT,   "3",     1,   3,      "menu") \
+		X(MENU_START_HOUR,  "menuStartHour",    INT,   "9",     0,   23,     "menu") \
+		X(MENU_END_HOUR,    "menuEndHour",      INT,   "14",    0,   23,     "menu") \
+		X(MENU_SHOW_TOMORROW, "menuShowTomorrow", BOOL, "0",    0,   1,      "menu") \
+		X(LST_MQTT,         "lstMqtt",          BOOL,  "0",     0,   1,      "lst") \
+		X(LST_SPARKLINE,    "lstSparkline",     BOOL,  "0",     0,   1,      "lst") \
+		X(TRACE_ENABLED,    "traceEnabled",     BOOL,  "0",     0,   1,      "") \
+		X(STALL_THRESHOLD,  "stallThreshold",   INT,   "2000",  0,   60000,  "")
+
+	#define CONFIG_FIELD_ID(id, key, type, def, min, max, owner) id,
+	enum Field: uint8_t {CONFIG_FIELDS(CONFIG_FIELD_ID) FIELD_COUNT};
+	#undef CONFIG_FIELD_ID
+
+	//parses all the fields from the DataStore, called after the configuration is read,
+	//afterwards every field is parsed again when its key is changed with DataStore::set
+	void load();
+
+	int32_t getInt(Field f);
+	float getFloat(Field f);
+	bool getBool(Field f);
+
+	//key and the owning task, for the pages and the reloads
+	String getKey(Field f);
+	String getOwner(Field f);
+
+	//one line per invalid value
+	std::vector<String> getErrors();
+}
+
+#endif /* CONFIGSCHEMA_H_ */
@@ -0,0 +1,67 @@
+/*
+ * Coroutine.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef COROUTINE_H_
+#define COROUTINE_H_
+
+#include "Arduino.h"
+#include "tasks_utils.h"
+
+//Protothread-style coroutines for tasks: run() is written as one linear
+//sequence between CO_BEGIN and CO_END and returns to the scheduler at every
+//await. The position is kept as the line number of the last await, so:
+// - locals don't survive an await, keep the state in members,
+// - no locals with initializers may be declared across an await,
+// - break/continue at the top level would leave the switch, use them in loops only.
+//A task mixes it in next to Tasks::Task: class X: public Tasks::Task, public Coroutine
+//A slow task waits for an idle window of the display before every step, but for
+//the polls of the awaits and CO_YIELD_SHORT - only its blocking steps need one.
+
+class Coroutine
+{
+	protected:
+		uint16_t coLine = 0;		//line of the await to continue from, 0 - start
+		uint64_t coDeadline = 0;	//micros64() timeout of the pending await
+		bool	 coTimedOut = false;	//set by the awaits with a timeout
+
+		//start from CO_BEGIN on the next run, e.g. from reset()
+		void coRestart() {coLine = 0;}
+};
+
+//how often the awaited conditions are checked
+#define CO_POLL_MS 10
+
+#define CO_BEGIN() switch (coLine) { case 0:
+#define CO_END() } coLine = 0
+
+//gives the other tasks a pass, continues in the next one
+#define CO_YIELD() do { coLine = __LINE__; return; case __LINE__:; } while (0)
+
+//leaves the coroutine, the next run starts from the beginning
+#define CO_RETURN() do { coLine = 0; return; } while (0)
+
+//as CO_YIELD, the next step is short and a slow task doesn't wait for a window
+#define CO_YIELD_SHORT() do { nextRunIsShort(this); CO_YIELD(); } while (0)
+
+#define CO_AWAIT_SLEEP(ms) do { sleepFor(this, ms); CO_YIELD(); } while (0)
+
+//continues once cond is true or after timeoutMs, coTimedOut tells which one
+#define CO_AWAIT_UNTIL(cond, timeoutMs) do { \
+	coDeadline = micros64() + (timeoutMs) * 1000ULL; \
+	coLine = __LINE__; case __LINE__: \
+	coTimedOut = false; \
+	if (!(cond)) { \
+		if (micros64() < coDeadline) { sleepFor(this, CO_POLL_MS); nextRunIsShort(this); return; } \
+		coTimedOut = true; \
+	} \
+} while (0)
+
+//data arrived or the peer closed the connection
+#define CO_AWAIT_READABLE(client, timeoutMs) \
+	CO_AWAIT_UNTIL((client).available() || !(client).connected(), timeoutMs)
+
+#endif /* COROUTINE_H_ */
@@ -6,40 +6,334 @@
  */
 
 #include "DataStore.h"
+#include <algorithm>
 
-static DataStore::DataStore<String, String>& dataStore()
+using namespace DataStore;
+
+struct Entry
+{
+	String key;
+	uint32_t hash;
+};
+
+//the entries are indexed by the ids, the table maps the hashes to the ids
+//with linear probing - nothing is ever removed from it; the ids are also
+//kept in the order of the keys for the prefix scans
+struct Store
+{
+	std::vector<Entry> entries;
+	std::vector<Id> table;
+	std::vector<Id> sorted;
+
+	//the published values (indexed by the ids, nullptr - no value, may be shorter
+	//than the entries) and the ones being changed by an update
+	std::shared_ptr<const Values> current = std::make_shared<const Values>();
+	std::shared_ptr<Values> next;
+	std::vector<Id> changed;
+	uint8_t updates = 0;
+};
+
+static Store& dataStore()
 {
-	static DataStore::DataStore<String, String> ds;
+	static Store ds;
 	return ds;
 }
 
-bool DataStore::hasValue(const String& key)
+static std::vector<std::pair<String, Callback>>& subscribers()
 {
-	return dataStore().hasKey(key);
+	static std::vector<std::pair<String, Callback>> s;
+	return s;
 }
 
-String& DataStore::value(const String& key)
+//the key is a copy - a subscriber may add new keys and move the entries
+static void notify(String key)
 {
-	return dataStore().value(key);
+	for (const auto& s: subscribers())
+	{
+		if (key.startsWith(s.first))
+			s.second(key);
+	}
 }
 
-const String& DataStore::valueOrDefault(const String& key, const String& def)
+//the load of the table is kept under 3/4
+const static size_t INITIAL_TABLE_SIZE = 32;
+
+uint32_t DataStore::hash(const __FlashStringHelper* s)
 {
-	return dataStore().valueOrDefault(key, def);
+	const char* p = (const char*)s;
+	uint32_t h = 2166136261u;
+
+	while (uint8_t c = pgm_read_byte(p++))
+		h = (h ^ c) * 16777619u;
+
+	return h;
+}
+
+static bool sameName(const Entry& e, const Key& key)
+{
+	return e.hash == key.hash &&
+			(key.flash ? strcmp_P(e.key.c_str(), key.name): strcmp(e.key.c_str(), key.name)) == 0;
+}
+
+//the slot of the key or the empty one where it belongs
+static size_t findSlot(const Key& key)
+{
+	auto& entries = dataStore().entries;
+	auto& table = dataStore().table;
+
+	size_t mask = table.size() - 1;
+	size_t slot = key.hash & mask;
+
+	while (table[slot] != NO_ID && !sameName(entries[table[slot]], key))
+		slot = (slot + 1) & mask;
+
+	return slot;
+}
+
+static void growTable()
+{
+	auto& entries = dataStore().entries;
+	auto& table = dataStore().table;
+
+	table.assign(table.empty() ? INITIAL_TABLE_SIZE: table.size() * 2, NO_ID);
+
+	size_t mask = table.size() - 1;
+	for (Id id = 0; id < entries.size(); ++id)
+	{
+		size_t slot = entries[id].hash & mask;
+		while (table[slot] != NO_ID)
+			slot = (slot + 1) & mask;
+		table[slot] = id;
+	}
+}
+
+//the first key in the order that is not less than s
+static std::vector<Id>::iterator firstNotBefore(const char* s)
+{
+	auto& entries = dataStore().entries;
+	auto& sorted = dataStore().sorted;
+
+	return std::lower_bound(sorted.begin(), sorted.end(), s,
+			[&entries](Id id, const char* s) {return strcmp(entries[id].key.c_str(), s) < 0;});
+}
+
+Id DataStore::find(const Key& key)
+{
+	auto& table = dataStore().table;
+
+	if (table.empty())
+		return NO_ID;
+
+	return table[findSlot(key)];
+}
+
+Id DataStore::intern(const Key& key)
+{
+	auto& entries = dataStore().entries;
+	auto& table = dataStore().table;
+
+	Id id = find(key);
+	if (id != NO_ID)
+		return id;
+
+	if ((entries.size() + 1) * 4 > table.size() * 3)
+		growTable();
+
+	id = entries.size();
+	entries.push_back(Entry{key.flash ? String((const __FlashStringHelper*)key.name): String(key.name), key.hash});
+	table[findSlot(key)] = id;
+
+	auto& sorted = dataStore().sorted;
+	sorted.insert(firstNotBefore(entries.back().key.c_str()), id);
+	return id;
+}
+
+static const String& noValue()
+{
+	static const String empty;
+	return empty;
+}
+
+static const String* lookup(const Values& values, Id id)
+{
+	if (id == NO_ID || id >= values.size() || !values[id])
+		return nullptr;
+
+	return values[id].get();
+}
+
+const String& Snapshot::value(Id id) const
+{
+	auto v = lookup(*values, id);
+	return v ? *v: noValue();
+}
+
+bool Snapshot::hasValue(Id id) const
+{
+	return lookup(*values, id) != nullptr;
+}
+
+const String& Snapshot::value(const Key& key) const
+{
+	return value(find(key));
+}
+
+bool Snapshot::hasValue(const Key& key) const
+{
+	return hasValue(find(key));
+}
+
+const String& Snapshot::valueOrDefault(const Key& key, const String& def) const
+{
+	auto v = lookup(*values, find(key));
+	return v ? *v: def;
+}
+
+Snapshot DataStore::snapshot()
+{
+	return Snapshot(dataStore().current);
+}
+
+//the shared values are kept alive by the current snapshot, no copy of the pointer needed
+const String& DataStore::value(Id id)
+{
+	auto v = lookup(*dataStore().current, id);
+	return v ? *v: noValue();
+}
+
+bool DataStore::hasValue(Id id)
+{
+	return lookup(*dataStore().current, id) != nullptr;
+}
+
+const String& DataStore::value(const Key& key)
+{
+	return value(find(key));
+}
+
+bool DataStore::hasValue(const Key& key)
+{
+	return hasValue(find(key));
+}
+
+const String& DataStore::valueOrDefault(const Key& key, const String& def)
+{
+	auto v = lookup(*dataStore().current, find(key));
+	return v ? *v: def;
 }
 
 std::vector<String> DataStore::availableKeys()
 {
-	return dataStore().getKeys();
+	std::vector<String> keys;
+	forEach(String(), [&keys](const String& key, const String&) {keys.push_back(key);});
+	return keys;
+}
+
+void DataStore::forEach(const String& prefix, EntryCallback callback)
+{
+	auto& entries = dataStore().entries;
+	auto& sorted = dataStore().sorted;
+	//held, the callback may change the values
+	auto values = dataStore().current;
+
+	//the keys with the prefix are next to each other, starting with the first not less than it
+	for (auto it = firstNotBefore(prefix.c_str()); it != sorted.end(); ++it)
+	{
+		const Entry& e = entries[*it];
+		if (!e.key.startsWith(prefix))
+			break;
+
+		if (auto v = lookup(*values, *it))
+			callback(e.key, *v);
+	}
+}
+
+//the values with the changes of the running update
+static const Values& latest()
+{
+	auto& ds = dataStore();
+	return ds.next ? *ds.next: *ds.current;
+}
+
+static void publish()
+{
+	auto& ds = dataStore();
+	if (!ds.next)
+		return;
+
+	ds.current = std::move(ds.next);
+	ds.next.reset();
+
+	//a subscriber may change the values again
+	std::vector<Id> changed;
+	changed.swap(ds.changed);
+	for (Id id: changed)
+		notify(ds.entries[id].key);
+}
+
+//nullptr removes the value
+static void change(Id id, std::shared_ptr<const String> value)
+{
+	auto& ds = dataStore();
+	if (!ds.next)
+		ds.next = std::make_shared<Values>(*ds.current);
+
+	if (ds.next->size() <= id)
+		ds.next->resize(ds.entries.size());
+
+	(*ds.next)[id] = std::move(value);
+	if (std::find(ds.changed.begin(), ds.changed.end(), id) == ds.changed.end())
+		ds.changed.push_back(id);
+
+	if (ds.updates == 0)
+		publish();
 }
 
-void DataStore::erase(const String& key)
+void DataStore::erase(const Key& key)
 {
-	dataStore().erase(key);
+	Id id = find(key);
+	if (lookup(latest(), id) == nullptr)
+		return;
+
+	change(id, nullptr);
 }
 
 void DataStore::clear()
 {
-	dataStore().clear();
+	beginUpdate();
+
+	for (Id id = 0; id < latest().size(); ++id)
+	{
+		if (lookup(latest(), id))
+			change(id, nullptr);
+	}
+
+	endUpdate();
+}
+
+void DataStore::set(const Key& key, const String& value)
+{
+	Id id = intern(key);
+	auto v = lookup(latest(), id);
+	if (v && *v == value)
+		return;
+
+	change(id, std::make_shared<const String>(value));
+}
+
+void DataStore::beginUpdate()
+{
+	dataStore().updates++;
 }
 
+void DataStore::endUpdate()
+{
+	auto& ds = dataStore();
+	if (ds.updates && --ds.updates == 0)
+		publish();
+}
+
+void DataStore::subscribe(const String& prefix, Callback callback)
+{
+	subscribers().emplace_back(prefix, callback);
+}
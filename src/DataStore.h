@@ -11,68 +11,103 @@
 #include <Arduino.h>
 #include <vector>
 #include <utility>
-#include <map>
+#include <functional>
+#include <memory>
 
 namespace DataStore
 {
-	String&	value(const String& key);
-	bool	hasValue(const String& key);
-	const String& valueOrDefault(const String& key, const String& def);
-	std::vector<String> availableKeys();
-	void erase(const String& key);
-	void clear();
+	//FNV-1a, for the literals it's calculated by the compiler
+	constexpr uint32_t hash(const char* s, uint32_t h = 2166136261u)
+	{
+		return *s ? hash(s + 1, (h ^ (uint8_t)*s) * 16777619u): h;
+	}
+
+	uint32_t hash(const __FlashStringHelper* s);
 
-	template <class S, class T>
-	class DataStore
+	//Name of a value and its hash, made from a literal, a flash string or a String
+	//(which has to live as long as the key). Nothing is allocated to look it up:
+	//  constexpr DataStore::Key brightnessKey("brightness");
+	struct Key
 	{
-		public:
-			DataStore() {}
-			virtual ~DataStore() {}
+		constexpr Key(const char* name): name(name), hash(DataStore::hash(name)), flash(false) {}
+		constexpr Key(const char* name, uint32_t hash): name(name), hash(hash), flash(false) {}
+		Key(const __FlashStringHelper* name): name((const char*)name), hash(DataStore::hash(name)), flash(true) {}
+		Key(const String& name): name(name.c_str()), hash(DataStore::hash(name.c_str())), flash(false) {}
+
+		const char* name;
+		uint32_t hash;
+		bool flash;
+	};
 
-			bool hasKey(const S& key)
-			{
-				return data.count(key) == 1;
-			}
+	//Every key gets a small number the first time it's seen and keeps it till the
+	//reboot (erase and clear only drop the values), so the ids can be kept by the
+	//users of the hot keys and used without hashing at all.
+	using Id = uint16_t;
+	const static Id NO_ID = UINT16_MAX;
+
+	Id		intern(const Key& key);
+	//NO_ID if the key was never seen
+	Id		find(const Key& key);
+
+	//The values are kept in immutable snapshots: a change makes a copy of the
+	//pointers, replaces the changed value in it and publishes it with one swap.
+	//The unchanged values are shared, so a reference to one of them stays valid
+	//till the value itself changes. Nothing is inserted by a lookup.
+	using Values = std::vector<std::shared_ptr<const String>>;
+
+	//the values at one moment, unchanged by the later writes and reloads:
+	//  auto s = DataStore::snapshot();
+	//  connect(s.value(F("mqttServer")), s.value(F("mqttUser")), s.value(F("mqttPassword")));
+	class Snapshot
+	{
+		public:
+			explicit Snapshot(std::shared_ptr<const Values> values): values(std::move(values)) {}
 
-			const T& valueOrDefault(const S& key, const T& def)
-			{
-				if (not hasKey(key))
-					return def;
+			//an empty string if there is no value
+			const String& value(Id id) const;
+			bool hasValue(Id id) const;
 
-				return value(key);
-			}
+			const String& value(const Key& key) const;
+			bool hasValue(const Key& key) const;
+			const String& valueOrDefault(const Key& key, const String& def) const;
 
-			T& value(const S& key)
-			{
-				return data[key];
-			}
+		private:
+			std::shared_ptr<const Values> values;
+	};
 
-			std::vector<S> getKeys()
-			{
+	Snapshot snapshot();
 
-				std::vector<S> keys;
-				for (const auto& p: data)
-				{
-					keys.emplace_back(p.first);
-				}
+	//the same on the latest snapshot
+	const String& value(Id id);
+	bool	hasValue(Id id);
 
-				return keys;
-			}
+	const String& value(const Key& key);
+	bool	hasValue(const Key& key);
+	const String& valueOrDefault(const Key& key, const String& def);
+	//a copy of all the present keys in the alphabetical order
+	std::vector<String> availableKeys();
 
-			void erase(const S& key)
-			{
-				data.erase(key);
-			}
+	//the present keys starting with the prefix in the alphabetical order, without
+	//copying; the time depends on the number of the matches, not of all the keys.
+	//The values are the ones from the start of the scan. The callback must not add new keys.
+	using EntryCallback = std::function<void(const String& key, const String& value)>;
+	void forEach(const String& prefix, EntryCallback callback);
+	void erase(const Key& key);
+	void clear();
 
-			void clear()
-			{
-				data.clear();
-			}
+	//stores the value and calls the subscribers of the key if it changed
+	void set(const Key& key, const String& value);
 
-		private:
+	//the changes made between them are published together at the end (the
+	//readers see either all the old or all the new values), then the subscribers
+	//are called; can be nested
+	void beginUpdate();
+	void endUpdate();
 
-			std::map<S, T> data;
-	};
+	//called with the key after its value was changed by set, erase or clear, in
+	//the order of subscribing; keep it short - set a flag, wake the task up
+	using Callback = std::function<void(const String& key)>;
+	void subscribe(const String& prefix, Callback callback);
 }
 
 #endif /* DATASTORE_H_ */
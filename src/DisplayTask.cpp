@@ -14,22 +14,32 @@
 #include "utils.h"
 #include "tasks_utils.h"
 #include "DataStore.h"
+#include "ConfigSchema.h"
+#include "Variables.h"
 
 #include "config.h"
 
-
+//the dwell may grow when the cycle budget leaves some time, but not more than that
+#define MAX_EXTRA_DWELL 3_s
 DisplayTask::DisplayTask():
 		TaskCRTP(&DisplayTask::nextMessage),
 		ledMatrixDriver(
-				readConfigWithDefault(F("segments"), "8").toInt(), LED_CS,
-				readConfigWithDefault(F("rotation"), "0").toInt()),
+				Config::getInt(Config::SEGMENTS), LED_CS,
+				Config::getInt(Config::ROTATION)),
 				scroll(ledMatrixDriver),
 		regularMessages({
 			{this, getDate, 2_s,	1,	false},
 			})
 {
 	init();
-	ledMatrixDriver.setIntensity(readConfig(F("brightness")).toInt());
+	ledMatrixDriver.setIntensity(Config::getInt(Config::BRIGHTNESS));
+	DataStore::subscribe(Config::getKey(Config::BRIGHTNESS), [this](const String&) {
+		ledMatrixDriver.setIntensity(Config::getInt(Config::BRIGHTNESS));
+	});
+
+	Variables::addInt(F("display.messages"), [this]() {return (int32_t)regularMessages.size();});
+	Variables::addInt(F("display.pending"), [this]() {return (int32_t)priorityMessages.size();});
+	Variables::addInt(F("display.scrollPeriod"), [this]() {return scrollPeriod * MS_PER_CYCLE;}, " ms");
 }
 
 
@@ -75,14 +85,16 @@ void DisplayTask::pushMessage(const String& m, uint16_t sleep, bool scrolling)
 	if (!priorityMessagePlayed)
 	{
 		nextState = &DisplayTask::nextMessage;
-		resume();
+		wakeTask(this);
 	}
 }
 
 void DisplayTask::scrollMessage()
 {
 	bool done = scroll.tick();
-	sleep(ds.period);
+	sleep(scrollPeriod);
+	//the text stands still at the beginning and at the end
+	announceIdleWindow(scroll.getStillTicks() * scrollPeriod * MS_PER_CYCLE);
 
 	if (done)
 	{
@@ -98,14 +110,87 @@ void DisplayTask::nextMessage()
 
 	if (ds.scrolling)
 	{		
-		scroll.renderString(currentMessage, myTestFont::font);
-		nextState = &DisplayTask::scrollMessage;
+		//a long text takes more than one pass to render
+		scroll.startRender(currentMessage, myTestFont::font);
+		nextState = &DisplayTask::renderMessage;
+		renderMessage();
 		return;
 	}
 
 	nextState = &DisplayTask::refreshMessage;
 }
 
+void DisplayTask::renderMessage()
+{
+	//no sleep - the next slice runs in the next pass
+	if (!scroll.renderSlice())
+		return;
+
+	planScroll();
+	nextState = &DisplayTask::scrollMessage;
+}
+
+// Scroll speed and dwell are calculated for every scrolled message from:
+//  scrollSpeed  - target reading speed in columns per second (0 - use the period of the message)
+//  scrollDwell  - time the text stays still at the beginning and at the end (seconds)
+//  displayCycle - time budget for one rotation of the regular messages (seconds, 0 - no budget)
+// The budget uses the lengths seen during the previous rotation for the other messages.
+void DisplayTask::planScroll()
+{
+	uint16_t columns = scroll.getScrollLength();
+	if (!priorityMessagePlayed)
+		regularMessages[index].columns = columns;
+
+	int32_t period = ds.period;
+	float speed = Config::getFloat(Config::SCROLL_SPEED);
+	if (speed > 0)
+		period = 1_s / speed;
+
+	int32_t dwell = Config::getFloat(Config::SCROLL_DWELL) * 1_s;
+	int32_t budget = Config::getInt(Config::DISPLAY_CYCLE) * 1_s;
+
+	//priority messages are not a part of the rotation
+	if (budget > 0 && !priorityMessagePlayed)
+	{
+		int32_t fixedTime = 0;
+		int32_t totalColumns = 0;
+		int32_t dwells = 0;
+
+		for (const auto& m: regularMessages)
+		{
+			if (!m.scrolling)
+			{
+				fixedTime += m.period * m.cycles;
+				continue;
+			}
+
+			totalColumns += m.columns;
+			//texts that fit the display only stay for one dwell
+			dwells += m.columns ? 2: 1;
+		}
+
+		int32_t available = budget - fixedTime - dwells * dwell;
+
+		if (available <= 0)
+		{
+			//the static messages already use the whole budget, go as fast as possible
+			period = 1;
+			dwell = 1;
+		}
+		else if (totalColumns && available / totalColumns < period)
+		{
+			period = available / totalColumns;
+		}
+		else
+		{
+			int32_t spare = available - totalColumns * period;
+			dwell += std::min<int32_t>(spare / dwells, MAX_EXTRA_DWELL);
+		}
+	}
+
+	scrollPeriod = std::max<int32_t>(std::min<int32_t>(period, UINT16_MAX), 1);
+	scroll.setEndDelay(dwell / scrollPeriod);
+}
 
 void DisplayTask::refreshMessage()
 {
@@ -118,8 +203,8 @@ void DisplayTask::refreshMessage()
 		nextState = &DisplayTask::nextMessage;
 
 	sleep(ds.period);
-	//this flag will allow slow tasks to execute only if there is a two second sleep ahead
-	slowTaskCanExecute = ds.period >= 1_s;
+	//nothing changes on the display till the next refresh, slow tasks can use this time
+	announceIdleWindow(ds.period * MS_PER_CYCLE);
 }
 
 
@@ -151,11 +236,12 @@ void DisplayTask::nextDisplay()
 
 		// save the current message for future use
 		currentMessage = ds.fun();
+		if (currentMessage.length() == 0)
+			regularMessages[index].columns = 0;
 	}
 	while (currentMessage.length() == 0);	
 
 	logPrintfX(F("DT"), F("New message from RQ = %s"), currentMessage.c_str());
-	ledMatrixDriver.setIntensity(readConfig(F("brightness")).toInt());
 }
 
 DisplayTask& DisplayTask::getInstance()
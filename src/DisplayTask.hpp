@@ -27,6 +27,7 @@ struct DisplayState
 		uint16_t	period;
 		uint16_t 	cycles;
 		bool		scrolling;		//refresh till it's done		
+		uint16_t	columns;		//scroll length seen last time, used for the cycle budget
 };
 
 
@@ -41,6 +42,7 @@ class DisplayTask: public Tasks::TaskCRTP<DisplayTask>
 		void pushMessage(const String& m, uint16_t sleep, bool scrolling = false);
 
 		void nextMessage();
+		void renderMessage();
 		void scrollMessage();
 		void refreshMessage();
 
@@ -53,6 +55,7 @@ class DisplayTask: public Tasks::TaskCRTP<DisplayTask>
 
 	private:
 		void nextDisplay();
+		void planScroll();
 
 		int index = 0;
 		LEDMatrixDriver ledMatrixDriver;
@@ -63,6 +66,7 @@ class DisplayTask: public Tasks::TaskCRTP<DisplayTask>
 		std::vector<DisplayState> priorityMessages;
 		bool		priorityMessagePlayed = false;
 		String 		currentMessage;
+		uint16_t	scrollPeriod = 0;
 
 	public:
 		void handleConfigPage(ESP8266WebServer& webServer);
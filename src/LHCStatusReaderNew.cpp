@@ -16,6 +16,9 @@
 #include "utils.h"
 #include "tasks_utils.h"
 #include "web_utils.h"
+#include "TraceRecorder.h"
+#include "WorkItem.h"
+#include "config.h"
 
 static const char pageUrl[] PROGMEM = "https://alicedcs.web.cern.ch/monitoring/screenshots/rss.xml";
 
@@ -37,32 +40,62 @@ void LHCStatusReaderNew::reset()
 	beamEnergy = String();
 	beamMode = String();
 	refreshTime = String();
-}
 
+	//a request in progress is abandoned
+	httpClient.end();
+	response = String();
+	coRestart();
+}
 
-void LHCStatusReaderNew::run()
+//the connect (TLS) and the request are still blocking, the response is read in steps
+bool LHCStatusReaderNew::startRequest()
 {
-	HTTPClient httpClient;
-	BearSSL::WiFiClientSecure wifiClient;
-
 	wifiClient.setInsecure();
 
 	logPrintfX(F("LHC"), F("Reading LHC Status"));
 	httpClient.begin(wifiClient, pageUrl);
+	//HTTP/1.0 - no chunks, the body ends with the connection
+	httpClient.useHTTP10(true);
 
+	static uint16_t traceGet = Trace::registerName(F("lhc.get"));
+	Trace::begin(traceGet);
 	int httpCode = httpClient.GET();
+	Trace::end(traceGet);
 	if (httpCode != 200)
 	{
 		logPrintfX(F("LHC"), F("HTTP code: %d"), httpCode);
-		reset();		//this resets variables
-		sleep(60_s);
-		httpClient.end();
-		return;
-	}	
-	
+		return false;
+	}
+
 	logPrintfX(F("LHC"), "Response size: %d", httpClient.getSize());
 
-	String response = httpClient.getString();
+	response = String();
+	if (httpClient.getSize() > 0)
+		response.reserve(httpClient.getSize());
+	stream = httpClient.getStreamPtr();
+	return true;
+}
+
+//appends what has arrived, returns false if the time of the slice ran out before that
+bool LHCStatusReaderNew::readResponse()
+{
+	SliceBudget budget;
+	char buffer[128];
+
+	while (size_t n = std::min<size_t>(stream->available(), sizeof(buffer)))
+	{
+		if (budget.expired())
+			return false;
+
+		n = stream->read((uint8_t*)buffer, n);
+		response.concat(buffer, n);
+	}
+
+	return true;
+}
+
+void LHCStatusReaderNew::parseResponse()
+{
 	StringViewStream httpStream(response);
 	
 	while (httpStream.available())
@@ -107,12 +140,45 @@ void LHCStatusReaderNew::run()
 		}		
 	}
 
+	response = String();
+}
+
+void LHCStatusReaderNew::run()
+{
+	CO_BEGIN();
+
+	if (!startRequest())
+	{
+		reset();		//this resets variables
+		sleep(60_s);
+		CO_RETURN();
+	}
+
+	//only the connect needed an idle window, these steps are short
+	while (stream->connected() || stream->available())
+	{
+		CO_AWAIT_READABLE(*stream, HTTP_TIMEOUT_MS);
+		if (coTimedOut)
+		{
+			logPrintfX(F("LHC"), F("Response timed out"));
+			reset();
+			sleep(60_s);
+			CO_RETURN();
+		}
+
+		if (!readResponse())
+			CO_YIELD_SHORT();
+	}
+
 	httpClient.end();
+	parseResponse();
 
 	refreshTime = getDateTime();
 
 	logPrintfX(F("LHC"), F("Done!"));
 	sleep(60_s);
+
+	CO_END();
 }
 
 
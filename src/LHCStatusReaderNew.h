@@ -11,7 +11,11 @@
 #include <tasks.hpp>
 
 #include <ESP8266WebServer.h>
-class LHCStatusReaderNew: public Tasks::Task
+#include <ESP8266HTTPClient.h>
+#include <WiFiClientSecureBearSSL.h>
+#include "Coroutine.h"
+
+class LHCStatusReaderNew: public Tasks::Task, public Coroutine
 {
 	public:
 		LHCStatusReaderNew();
@@ -24,6 +28,16 @@ class LHCStatusReaderNew: public Tasks::Task
 		String page1Comment;
 		String refreshTime;
 
+		//state of the request in progress
+		HTTPClient httpClient;
+		BearSSL::WiFiClientSecure wifiClient;
+		WiFiClient* stream = nullptr;
+		String response;
+
+		bool startRequest();
+		bool readResponse();
+		void parseResponse();
+
 		void handleStatusPage(ESP8266WebServer& ws);
 
 		String getEnergy();
@@ -7,13 +7,20 @@
 
 #include "LocalSensorTask.h"
 #include "DataStore.h"
+#include "ConfigSchema.h"
 #include "utils.h"
 #include "tasks_utils.h"
 #include "config.h"
 #include "web_utils.h"
 #include "WebServerTask.h"
+#include "Variables.h"
 #include <DisplayTask.hpp>
 
+bool isTemperatureValid(float f)
+{
+	return (f != -127.0f) && (f != 85.0);
+}
+
 LocalSensorTask::LocalSensorTask():
 	oneWire(ONE_WIRE_TEMP),
 	dallasTemperature(&oneWire)
@@ -32,15 +39,13 @@ LocalSensorTask::LocalSensorTask():
 	registerPage(F("lst"), F("Local Sensors"), [this](ESP8266WebServer& webServer) {handlePage(webServer);});
 
 	addRegularMessage({this, [this](){return formatTemperature();}, 3_s, 1, false});
+	Variables::addFloat(F("lst.temperature"), [this]() {return isTemperatureValid(temperature) ? temperature: NAN;});
+	if (Config::getBool(Config::LST_SPARKLINE))
+		addRegularMessage({this, [this](){return formatHistory();}, 3_s, 1, false});
 
 	sleep(10_s);
 }
 
-bool isTemperatureValid(float f)
-{
-	return (f != -127.0f) && (f != 85.0);
-}
-
 void LocalSensorTask::run()
 {
     const int maxRetries = 3;
@@ -62,16 +67,17 @@ void LocalSensorTask::run()
     }
 
     temperature = t;
-    if (DataStore::value(F("lstMqtt")).toInt())
+    history.add(isValid ? t: NAN);
+    if (Config::getBool(Config::LST_MQTT))
     {
         if (isValid)
-            DataStore::value(F("lstTemperature")) = String(t, 1);
+            DataStore::set(F("lstTemperature"), String(t, 1));
         else
             DataStore::erase(F("lstTemperature"));
     }
 
     dallasTemperature.requestTemperatures();
-    sleep(30_s);
+    sleepPeriodic(this, 30000);
 }
 
 
@@ -110,3 +116,11 @@ String LocalSensorTask::formatTemperature()
 	p += "C";
 	return p;
 }
+
+String LocalSensorTask::formatHistory()
+{
+	//the last quarters behind the thermometer, as many as fit the display:
+	//"\x81 " takes 9 columns, 6 of the glyph and 3 of the space
+	int columns = Config::getInt(Config::SEGMENTS) * 8 - 9;
+	return "\x81 " + history.sparkline(1, std::max(columns, 1));
+}
@@ -12,6 +12,7 @@
 #include <OneWire.h>
 #include <DallasTemperature.h>
 #include <ESP8266WebServer.h>
+#include "TimeSeries.h"
 
 class LocalSensorTask: public Tasks::Task
 {
@@ -26,10 +27,14 @@ class LocalSensorTask: public Tasks::Task
 		void handlePage(ESP8266WebServer& webserver);
 
 		String formatTemperature();		
-		
+		String formatHistory();
+
 	private:
 		OneWire oneWire;
 		DallasTemperature dallasTemperature;
+
+		//48 h of minutes, a week of quarters, a month of hours - 4.3 KB
+		TimeSeries history{F("lst"), {{60, 2880}, {900, 672}, {3600, 720}}, 10, true};
 };
 
 #endif /* LOCALSENSORTASK_H_ */
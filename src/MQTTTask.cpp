@@ -8,14 +8,18 @@
 #include <MQTTTask.h>
 #include "utils.h"
 #include "tasks_utils.h"
+#include "config.h"
 #include <MapCollector.hpp>
 #include "WebServerTask.h"
 #include "web_utils.h"
 #include <DataStore.h>
+#include "TraceRecorder.h"
+#include "ConfigJournal.h"
 
 
 MQTTTask::MQTTTask():
-    mqttClient(wifiClient)
+    mqttClient(wifiClient),
+    poll(this, MQTT_POLL_MIN, MQTT_POLL_MAX)
 {
     addRegularMessage({this, [this](){return getMessage();}, 0.035_s, 1, true});
 
@@ -23,13 +27,15 @@ MQTTTask::MQTTTask():
     {
         callback(topic, payload, length);
     });
-    suspend();
 }
 
 void MQTTTask::reset()
 {
     mqttClient.disconnect();
-    auto mqttServer = DataStore::value(F("mqttServer"));
+
+    //all the values from one reload
+    auto config = DataStore::snapshot();
+    auto mqttServer = config.value(F("mqttServer"));
 
     if (mqttServer.length() == 0)
     {
@@ -40,13 +46,18 @@ void MQTTTask::reset()
 
     mqttClient.setServer(mqttServer.c_str(), 1883);
 
-    auto clientId = DataStore::valueOrDefault(F("mqttClientId"), F("InfoClock"));
-    auto user = DataStore::value(F("mqttUser"));
-    auto passwd = DataStore::value(F("mqttPassword"));
+    auto clientId = config.valueOrDefault(F("mqttClientId"), F("InfoClock"));
+    auto user = config.value(F("mqttUser"));
+    auto passwd = config.value(F("mqttPassword"));
 
     logPrintfX(F("MQT"), "Connecting (%s, %s)", mqttServer.c_str(), user.c_str());
 
-    if (not mqttClient.connect(clientId.c_str(), user.c_str(), passwd.c_str()))
+    static uint16_t traceConnect = Trace::registerName(F("mqtt.connect"));
+    Trace::begin(traceConnect);
+    bool connected = mqttClient.connect(clientId.c_str(), user.c_str(), passwd.c_str());
+    Trace::end(traceConnect);
+
+    if (not connected)
         return;
 
     logPrintfX(F("MQT"), "Connected!");
@@ -62,6 +73,8 @@ void MQTTTask::reset()
 
 void MQTTTask::callback(const char* topic_raw, byte* payload, unsigned int length)
 {
+    received = true;
+
     char msg[128];
     memset(msg, 0, sizeof(msg));
     memcpy(msg, payload, length);
@@ -84,6 +97,30 @@ void MQTTTask::callback(const char* topic_raw, byte* payload, unsigned int lengt
         return;
     }
 
+    //"<key>=<value>", stored in the config, an empty value removes the key;
+    //the passwords can't be read over MQTT, so they can't be written either
+    if (topic.endsWith("set"))
+    {
+        String line(msg);
+        auto p = splitLine(line);
+        if (p.first.endsWith("Password"))
+        {
+            logPrintfX(F("MQT"), F("%s can't be changed over MQTT"), p.first.c_str());
+            return;
+        }
+
+        if (!ConfigJournal::set(p.first, p.second))
+            logPrintfX(F("MQT"), F("Invalid config change: %s"), msg);
+        return;
+    }
+
+    //"<task> suspend|resume|period <ms>"
+    if (topic.endsWith("task"))
+    {
+        controlTask(msg);
+        return;
+    }
+
     if (topic.endsWith("request"))
     {
         String p(msg);
@@ -134,12 +171,13 @@ void MQTTTask::run()
                     continue;
                 }
 
-                mqttClient.publish(topic, dataSource(s).c_str());
+                mqttClient.publish(topic, value.c_str());
             }
         }
         lastReport = time(NULL);
     }
 
     mqttClient.loop();
-    sleep(0.05_s);
+    sleepFor(this, poll.next(received));
+    received = false;
 }
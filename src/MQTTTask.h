@@ -11,6 +11,7 @@
 #include <tasks.hpp>
 #include <PubSubClient.h>
 #include <WiFiClient.h>
+#include "AdaptivePoll.h"
 
 class MQTTTask: public Tasks::Task
 {
@@ -30,6 +31,9 @@ class MQTTTask: public Tasks::Task
         String message;
 
 		time_t lastReport = 0;
+
+		AdaptivePoll poll;
+		bool received = false;		//a message has arrived since the last poll
 		
         void callback(const char* topic, byte* payload, unsigned int length);
 };
@@ -11,6 +11,7 @@
 #include <pgmspace.h>
 #include <Stream.h>
 #include <functional>
+#include <algorithm>
 #include <vector>
 #include <map>
 
@@ -95,6 +96,32 @@ class StringViewStream: public Stream
 		size_t read_pos = 0;
 };
 
+class LimitedStream: public Stream
+{
+	public:
+		LimitedStream(Stream& s, size_t limit): s(s), left(limit) {}
+		virtual ~LimitedStream() {}
+
+		int available() override {return left ? std::min<int>(s.available(), left): 0;}
+
+		int read() override
+		{
+			if (!left)
+				return -1;
+
+			left--;
+			return s.read();
+		}
+
+		int peek() override {return left ? s.peek(): -1;}
+
+		size_t write(uint8_t c) override {return 0;}
+
+		void flush() override {}
+
+		Stream& s;
+		size_t left;
+};
 
 using Lookup = std::function<String(const char*)>;
 
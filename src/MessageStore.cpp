@@ -0,0 +1,333 @@
+/*
+ * MessageStore.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include "MessageStore.h"
+#include "LittleFS.h"
+#include "MacroStringReplace.h"
+#include "time_utils.h"
+#include "utils.h"
+#include "config.h"
+
+const static uint32_t MESSAGE_STORE_MAGIC = 0x3147534D;		//"MSG1"
+const static size_t   MAX_TEXT_LENGTH = 0xFFFF;
+
+struct DeltaTimeReplacer
+{
+    DeltaTimeReplacer(time_t delta): delta(delta) {}
+
+    String operator()(const char* t)
+    {
+      String tag = t;
+      if (tag == "D") return formatDeltaTime(delta, DeltaTimePrecision::DAYS);
+      if (tag == "H") return formatDeltaTime(delta, DeltaTimePrecision::HOURS);
+      if (tag == "M") return formatDeltaTime(delta, DeltaTimePrecision::MINUTES);
+      if (tag == "S") return formatDeltaTime(delta, DeltaTimePrecision::SECONDS);
+
+      return dataSource(t);
+    }
+
+    time_t delta;
+};
+
+MessageStore::MessageStore(const char* fileName): fileName(fileName)
+{
+}
+
+void MessageStore::load()
+{
+	entries.clear();
+	nextId = 1;
+	tombstones = 0;
+	configHash = 0;
+	fileSize = 0;
+
+	LittleFS.begin();
+	auto file = LittleFS.open(fileName, "r");
+
+	FileHeader header{};
+	if (!file || file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+		header.magic != MESSAGE_STORE_MAGIC)
+	{
+		logPrintfX(F("MS"), F("Creating a new message file..."));
+		file.close();
+		file = LittleFS.open(fileName, "w");
+		header = FileHeader{MESSAGE_STORE_MAGIC, 0};
+		file.write((const uint8_t*)&header, sizeof(header));
+		fileSize = sizeof(header);
+		file.close();
+		LittleFS.end();
+		return;
+	}
+
+	configHash = header.configHash;
+	fileSize = sizeof(header);
+	uint32_t totalSize = file.size();
+
+	MessageRecord r;
+	while (fileSize + sizeof(r) <= totalSize)
+	{
+		if (file.read((uint8_t*)&r, sizeof(r)) != sizeof(r))
+			break;
+
+		uint32_t recordSize = sizeof(r) + r.beforeLength + r.afterLength;
+		if (fileSize + recordSize > totalSize)
+			break;
+
+		if (r.flags & DELETED)
+		{
+			auto it = std::find_if(entries.begin(), entries.end(),
+					[&r](const Entry& e) {return e.id == r.id;});
+			if (it != entries.end())
+				entries.erase(it);
+			tombstones += 2;
+		}
+		else if (entries.size() < MESSAGE_STORE_CAPACITY)
+		{
+			insert(Entry{fileSize, r.from, r.until, r.id, r.priority, r.flags});
+		}
+
+		if (r.id >= nextId)
+			nextId = r.id + 1;
+
+		fileSize += recordSize;
+		file.seek(fileSize, fs::SeekSet);
+	}
+
+	file.close();
+	LittleFS.end();
+
+	logPrintfX(F("MS"), F("Loaded %zu message(s), %u B"), entries.size(), fileSize);
+
+	//a record was cut in half (power loss during a write?), get rid of it
+	if (fileSize != totalSize)
+	{
+		logPrintfX(F("MS"), F("Truncated record found, compacting..."));
+		compact();
+	}
+}
+
+void MessageStore::insert(const Entry& e)
+{
+	//higher priority first, the same priority in the order of addition
+	auto it = std::upper_bound(entries.begin(), entries.end(), e,
+			[](const Entry& a, const Entry& b) {return a.priority > b.priority;});
+	entries.insert(it, e);
+}
+
+bool MessageStore::append(MessageRecord& r, const String& before, const String& after)
+{
+	LittleFS.begin();
+	auto file = LittleFS.open(fileName, "a");
+	bool ok = false;
+
+	if (file)
+	{
+		ok = file.write((const uint8_t*)&r, sizeof(r)) == sizeof(r) &&
+			 file.write((const uint8_t*)before.c_str(), r.beforeLength) == r.beforeLength &&
+			 file.write((const uint8_t*)after.c_str(), r.afterLength) == r.afterLength;
+		file.close();
+	}
+
+	LittleFS.end();
+
+	if (ok)
+		fileSize += sizeof(r) + r.beforeLength + r.afterLength;
+
+	return ok;
+}
+
+uint16_t MessageStore::add(const String& before, const String& after,
+		time_t when, time_t from, time_t until,
+		uint8_t priority, uint8_t flags)
+{
+	if (entries.size() >= MESSAGE_STORE_CAPACITY)
+	{
+		logPrintfX(F("MS"), F("The store is full, message dropped!"));
+		return 0;
+	}
+
+	MessageRecord r{nextId, priority, (uint8_t)(flags & ~DELETED),
+		(uint32_t)when, (uint32_t)from, (uint32_t)until,
+		(uint16_t)std::min<size_t>(before.length(), MAX_TEXT_LENGTH),
+		(uint16_t)std::min<size_t>(after.length(), MAX_TEXT_LENGTH)};
+
+	Entry e{fileSize, r.from, r.until, r.id, r.priority, r.flags};
+
+	if (!append(r, before, after))
+	{
+		logPrintfX(F("MS"), F("Failed to write the message!"));
+		return 0;
+	}
+
+	insert(e);
+
+	if (++nextId == 0)
+		nextId = 1;
+
+	return e.id;
+}
+
+bool MessageStore::remove(uint16_t id)
+{
+	auto it = std::find_if(entries.begin(), entries.end(),
+			[id](const Entry& e) {return e.id == id;});
+	if (it == entries.end())
+		return false;
+
+	MessageRecord r{id, 0, DELETED, 0, 0, 0, 0, 0};
+	if (!append(r, String(), String()))
+		return false;
+
+	entries.erase(it);
+	tombstones += 2;
+
+	if (tombstones > entries.size() && tombstones > 32)
+		compact();
+
+	return true;
+}
+
+void MessageStore::removeFlagged(uint8_t flags)
+{
+	auto it = std::remove_if(entries.begin(), entries.end(),
+			[flags](const Entry& e) {return e.flags & flags;});
+	if (it == entries.end())
+		return;
+
+	//the records are dropped by rewriting the file - no tombstones needed
+	std::vector<Entry> removed(it, entries.end());
+	entries.erase(it, entries.end());
+	if (compact())
+		return;
+
+	//the file is unchanged, the records have to be removed one by one
+	entries.insert(entries.end(), removed.begin(), removed.end());
+	for (const auto& e: removed)
+		remove(e.id);
+}
+
+bool MessageStore::compact()
+{
+	String tmpName = String(fileName) + ".tmp";
+
+	LittleFS.begin();
+	auto in = LittleFS.open(fileName, "r");
+	auto out = LittleFS.open(tmpName, "w");
+	bool ok = in && out;
+
+	FileHeader header{MESSAGE_STORE_MAGIC, configHash};
+	ok = ok && out.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+	uint32_t position = sizeof(header);
+
+	//the entries keep the old offsets till the new file replaces the old one
+	std::vector<uint32_t> offsets;
+	offsets.reserve(entries.size());
+
+	uint8_t buffer[64];
+	for (const auto& e: entries)
+	{
+		if (!ok)
+			break;
+
+		MessageRecord r;
+		ok = in.seek(e.offset, fs::SeekSet) &&
+				in.read((uint8_t*)&r, sizeof(r)) == sizeof(r) &&
+				out.write((const uint8_t*)&r, sizeof(r)) == sizeof(r);
+
+		size_t left = r.beforeLength + r.afterLength;
+		while (ok && left)
+		{
+			size_t chunk = in.read(buffer, std::min(left, sizeof(buffer)));
+			ok = chunk && out.write(buffer, chunk) == chunk;
+			left -= chunk;
+		}
+
+		offsets.push_back(position);
+		position += sizeof(r) + r.beforeLength + r.afterLength;
+	}
+
+	if (in)
+		in.close();
+	if (out)
+		out.close();
+
+	ok = ok && LittleFS.rename(tmpName.c_str(), fileName);
+	if (!ok)
+		LittleFS.remove(tmpName.c_str());
+	LittleFS.end();
+
+	if (!ok)
+	{
+		logPrintfX(F("MS"), F("Compacting failed, the file is unchanged"));
+		return false;
+	}
+
+	for (size_t i = 0; i < entries.size(); ++i)
+		entries[i].offset = offsets[i];
+
+	logPrintfX(F("MS"), F("Compacted %u B -> %u B"), fileSize, position);
+	fileSize = position;
+	tombstones = 0;
+	return true;
+}
+
+void MessageStore::setConfigHash(uint32_t hash)
+{
+	configHash = hash;
+
+	FileHeader header{MESSAGE_STORE_MAGIC, configHash};
+
+	LittleFS.begin();
+	auto file = LittleFS.open(fileName, "r+");
+	if (file)
+	{
+		file.write((const uint8_t*)&header, sizeof(header));
+		file.close();
+	}
+	LittleFS.end();
+}
+
+bool MessageStore::isActive(const Entry& e, time_t now)
+{
+	if (e.from && now < (time_t)e.from)
+		return false;
+
+	if (e.until && now >= (time_t)e.until)
+		return false;
+
+	return true;
+}
+
+bool MessageStore::render(const Entry& e, time_t now, Stream& output) const
+{
+	LittleFS.begin();
+	auto file = LittleFS.open(fileName, "r");
+
+	MessageRecord r;
+	bool ok = file && file.seek(e.offset, fs::SeekSet) &&
+			  file.read((uint8_t*)&r, sizeof(r)) == sizeof(r);
+
+	if (ok)
+	{
+		time_t delta = r.when ? (time_t)r.when - now: 1;
+
+		size_t length = r.beforeLength;
+		if (delta <= 0)
+		{
+			file.seek(r.beforeLength, fs::SeekCur);
+			length = r.afterLength;
+		}
+
+		//the text goes from the flash through the macro replacement to the output
+		LimitedStream text(file, length);
+		macroStringReplaceS(text, DeltaTimeReplacer(delta), output);
+	}
+
+	file.close();
+	LittleFS.end();
+	return ok;
+}
@@ -0,0 +1,89 @@
+/*
+ * MessageStore.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef MESSAGESTORE_H_
+#define MESSAGESTORE_H_
+
+#include <Arduino.h>
+#include <vector>
+#include <time.h>
+
+// Messages are kept in an append-only file, only a small index lives in RAM.
+// The file starts with a FileHeader, then each record is a MessageRecord
+// followed by the "before" and "after" texts. Removing a message appends
+// a tombstone record, the file is compacted when there are too many of them.
+
+class MessageStore
+{
+	public:
+		const static uint8_t DELETED = 1;		//tombstone for the message with the same id
+		const static uint8_t FROM_CONFIG = 2;	//imported from the messages.N keys
+
+		struct Entry
+		{
+			uint32_t offset;	//of the record in the file
+			uint32_t from;		//display window, 0 - unbounded
+			uint32_t until;
+			uint16_t id;
+			uint8_t  priority;
+			uint8_t  flags;
+		};
+
+		MessageStore(const char* fileName);
+
+		void load();
+
+		//returns the id of the new message, 0 if the store is full
+		uint16_t add(const String& before, const String& after,
+				time_t when, time_t from, time_t until,
+				uint8_t priority, uint8_t flags = 0);
+		bool remove(uint16_t id);
+		void removeFlagged(uint8_t flags);
+
+		//streams the text valid at "now" with the macros replaced
+		bool render(const Entry& e, time_t now, Stream& output) const;
+
+		static bool isActive(const Entry& e, time_t now);
+
+		const std::vector<Entry>& getEntries() const {return entries;}
+		uint32_t getConfigHash() const {return configHash;}
+		void setConfigHash(uint32_t hash);
+		size_t getFileSize() const {return fileSize;}
+
+	private:
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t configHash;
+		};
+
+		struct MessageRecord
+		{
+			uint16_t id;
+			uint8_t  priority;
+			uint8_t  flags;
+			uint32_t when;
+			uint32_t from;
+			uint32_t until;
+			uint16_t beforeLength;
+			uint16_t afterLength;
+		};
+
+		void insert(const Entry& e);
+		bool append(MessageRecord& r, const String& before, const String& after);
+		//false if the file couldn't be rewritten, the old one and the entries stay then
+		bool compact();
+
+		const char*	fileName;
+		std::vector<Entry> entries;
+		uint32_t	configHash = 0;
+		uint32_t	fileSize = 0;
+		uint16_t	nextId = 1;
+		uint16_t	tombstones = 0;
+};
+
+#endif /* MESSAGESTORE_H_ */
@@ -8,133 +8,264 @@
 
 #include "MessagesTask.h"
 #include <DisplayTask.hpp>
-#include <iterator>
 #include "utils.h"
 #include "tasks_utils.h"
+#include "web_utils.h"
 #include "config.h"
 
 #define DEFAULT_DISPLAY_TIME 0.05_s
 
-MessagesTask::MessagesTask()
+#define MESSAGES_PER_PAGE 50
+
+MessagesTask::MessagesTask():
+  store("/messages.dat"),
+  allMessages(store)
 {
+  store.load();
+  allMessages.start();
+
+  DataStore::subscribe(F("messages."), [this](const String&) {configChanged = true; wakeTask(this);});
+  DataStore::subscribe(F("messagesSplit"), [this](const String&) {allMessages.start(); wakeTask(this);});
   addRegularMessage({this, [this](){return getMessages();}, DEFAULT_DISPLAY_TIME, 1, true});
+  registerPage(F("messages"), F("Messages"), [this](ESP8266WebServer& ws) {handlePage(ws);});
 }
 
 void MessagesTask::run()
 {
-  updateFromConfig();
-  sleep(60_s);
+  //no sleep till all the messages are rendered
+  if (!allMessages.runSlice())
+    return;
+
+  if (configChanged)
+  {
+    configChanged = false;
+    updateFromConfig();
+    allMessages.start();
+    return;
+  }
+
+  //till the next change of the config or getMessages
+  suspend();
 }
 
+//the messages.N keys are imported into the store only when they change,
+//the hash skips the import at the start if they are already there
 void MessagesTask::updateFromConfig()
 {
-  std::vector<String> new_message_keys;
-  const auto& all_keys = DataStore::availableKeys();
-  
-  std::copy_if(all_keys.begin(), 
-               all_keys.end(), 
-               std::back_inserter(new_message_keys),
-               [](const String& k) {return k.startsWith("messages.");});
+  //FNV-1a over all the keys and values as "key=value"
+  uint32_t hash = 2166136261u;
+  auto mix = [&hash](const char* s) {
+    while (*s)
+      hash = (hash ^ (uint8_t)*s++) * 16777619u;
+  };
+
+  size_t count = 0;
+  DataStore::forEach(F("messages."), [&](const String& k, const String& v) {
+    mix(k.c_str());
+    mix("=");
+    mix(v.c_str());
+    count++;
+  });
 
-  if (new_message_keys == messageKeys)
+  if (hash == store.getConfigHash())
   {
     logPrintfX(F("MSG"), F("No new keys..."));
     return;
   }
 
-  //new keys detected
-  messageKeys = std::move(new_message_keys);
+  store.removeFlagged(MessageStore::FROM_CONFIG);
+
+  DataStore::forEach(F("messages."), [this](const String&, const String& v) {
+    std::vector<String> fields = tokenize(v, ";");
+    if (fields.size() != 3)
+      return;
+
+    time_t when = fields[2].toInt();
+    if (not when)
+      return;
+
+    store.add(fields[0], fields[1], when, 0, 0, 0, MessageStore::FROM_CONFIG);
+  });
+
+  store.setConfigHash(hash);
   messageCycleIndex = 0;
   
-  logPrintfX(F("MSG"), F("Config for %zu message(s) found!"), messageKeys.size());
+  logPrintfX(F("MSG"), F("Config for %zu message(s) found!"), count);
 }
 
 String MessagesTask::getMessages()
 {
-  String result;
-  if (messageKeys.size() == 0)
-    return result;
+  const auto& entries = store.getEntries();
+  StringStream ss;
 
+  if (entries.size() == 0)
+    return ss.buffer;
+
+  //rendering them all at once could take long, the text is built in the background -
+  //this one is from the previous showing and the next one gets built now
   if (DataStore::hasValue("messagesSplit"))
   {
-    String messageSplit = DataStore::value("messagesSplit");
-    std::vector<String> messageToReturn = {"All messages:", messageSplit};
+    String text = allMessages.text;
+    allMessages.start();
+    wakeTask(this);
+    return text;
+  }
 
-    std::transform(messageKeys.begin(), messageKeys.end(),
-                   std::back_inserter(messageToReturn),
-                   [&messageToReturn, this, &messageSplit](const String& k) 
-                   {return getMessage(k) + messageSplit;});
+  time_t now = time(nullptr);
 
-    result = getOneStringFrom(messageToReturn);
-  }
-  else
+  //show the next message that is in its display window
+  for (size_t i = 0; i < entries.size(); ++i)
   {
-    result = getMessage(messageKeys[messageCycleIndex]);
+    if (messageCycleIndex >= entries.size())
+      messageCycleIndex = 0;
+
+    const auto& e = entries[messageCycleIndex++];
+    if (not MessageStore::isActive(e, now))
+      continue;
 
-    messageCycleIndex++;
-    if (messageCycleIndex >= messageKeys.size())
-        messageCycleIndex = 0;
+    store.render(e, now, ss);
+    logPrintfX(F("MSG"), "%s", ss.buffer.c_str());
+    break;
   }
-  return result;
+
+  return ss.buffer;
 }
 
-struct DeltaTimeReplacer
+void MessagesTask::AllMessages::start()
 {
-    DeltaTimeReplacer(time_t delta): delta(delta) {}
+  pending.buffer = String();
+  index = 0;
+  restartWork();
+}
 
-    String operator()(const char* t)
+bool MessagesTask::AllMessages::step()
+{
+  if (index == 0)
+  {
+    if (!DataStore::hasValue("messagesSplit"))
     {
-      String tag = t;
-      if (tag == "D") return formatDeltaTime(delta, DeltaTimePrecision::DAYS);
-      if (tag == "H") return formatDeltaTime(delta, DeltaTimePrecision::HOURS);
-      if (tag == "M") return formatDeltaTime(delta, DeltaTimePrecision::MINUTES);
-      if (tag == "S") return formatDeltaTime(delta, DeltaTimePrecision::SECONDS);
-
-      return dataSource(t);
+      text = String();
+      return true;
     }
 
-    time_t delta;
-};
+    split = DataStore::value("messagesSplit");
+    now = time(nullptr);
+    pending.print("All messages:");
+    pending.print(split);
+  }
 
+  //the entries may change between the steps
+  const auto& entries = store.getEntries();
+  if (index >= entries.size())
+  {
+    text = pending.buffer;
+    pending.buffer = String();
+    return true;
+  }
+
+  const auto& e = entries[index++];
+  if (MessageStore::isActive(e, now))
+  {
+    store.render(e, now, pending);
+    pending.print(split);
+  }
+
+  return false;
+}
 
-String MessagesTask::getMessage(String messageKey)
+static const char messagesForm[] PROGMEM = R"_(
+<form method="post" action="messages">
+<table>
+<tr><th>New message</th></tr>
+<tr><td class="l">Before:</td><td><input name="before" type="text"></td></tr>
+<tr><td class="l">After:</td><td><input name="after" type="text"></td></tr>
+<tr><td class="l">When (unix time):</td><td><input name="when" type="text"></td></tr>
+<tr><td class="l">From (unix time):</td><td><input name="from" type="text" value="0"></td></tr>
+<tr><td class="l">Until (unix time):</td><td><input name="until" type="text" value="0"></td></tr>
+<tr><td class="l">Priority:</td><td><input name="priority" type="text" value="0"></td></tr>
+<tr><td/><td><input type="submit" value="Add"></td></tr>
+</table>
+</form>
+<table>
+<tr><th>Stored messages: $count$ ($size$ B)</th></tr>
+)_";
+
+static const char messagesRow[] PROGMEM = R"_(
+<tr><td class="l">$id$ (p$priority$$config$):</td><td>$text$</td><td><form method="post" action="messages"><button name="delete" value="$id$">&#10006;</button></form></td></tr>
+)_";
+
+static const char messagesFooter[] PROGMEM = R"_(
+</table>
+<a href="messages?page=$next$">&rArr;</a>
+</body>
+</html>
+)_";
+
+FlashStream messagesFormFS(messagesForm);
+FlashStream messagesRowFS(messagesRow);
+FlashStream messagesFooterFS(messagesFooter);
+
+void MessagesTask::handlePage(ESP8266WebServer& webServer)
 {
-  String config = DataStore::valueOrDefault(messageKey, "...");
+  if (!handleAuth(webServer))
+    return;
 
-  std::vector<String> fields = tokenize(config,";");
-  if (fields.size() != 3)
-    return String();
+  //the changes come only by POST, a link (or a cross-site request) can't make one
+  if (webServer.method() == HTTP_POST)
+  {
+    if (webServer.hasArg(F("delete")))
+      store.remove(webServer.arg(F("delete")).toInt());
+    else
+      store.add(webServer.arg(F("before")), webServer.arg(F("after")),
+                webServer.arg(F("when")).toInt(),
+                webServer.arg(F("from")).toInt(),
+                webServer.arg(F("until")).toInt(),
+                webServer.arg(F("priority")).toInt());
 
-  time_t when = fields[2].toInt();
-  if (not when)
-    return String();
-  
-  time_t delta = when - time(NULL);
+    //back to the plain page, a reload won't repeat the change
+    webServer.sendHeader("Location", String("/messages"), true);
+    webServer.send(302, textPlain, "");
+    return;
+  }
 
-  const String& before = fields[0];
-  const String& after =  fields[1];
+  const auto& entries = store.getEntries();
+  size_t page = webServer.arg(F("page")).toInt();
+  size_t first = page * MESSAGES_PER_PAGE;
+  time_t now = time(nullptr);
 
-  String selected_string  = (delta > 0) ? before: after;
+  webServer.chunkedResponseModeStart(200, textHtml);
 
-  StringStream ss;
-  StringViewStream svs(selected_string);
-  DeltaTimeReplacer dtr(delta);
+  StringStream ss(2048);
+  macroStringReplace(pageHeaderFS, constString(F("Messages")), ss);
+  std::map<String, String> header = {
+    {F("count"), String(entries.size())},
+    {F("size"), String(store.getFileSize())},
+  };
+  macroStringReplace(messagesFormFS, mapLookup(header), ss);
+  webServer.sendContent(ss.buffer);
 
-  macroStringReplaceS(svs, dtr, ss);
-  
-  logPrintfX(F("MSG"), "%s", ss.buffer.c_str());
+  //one row at a time - there can be thousands of them
+  for (size_t i = first; i < entries.size() && i < first + MESSAGES_PER_PAGE; ++i)
+  {
+    const auto& e = entries[i];
 
-  return ss.buffer;
-}
+    StringStream text;
+    store.render(e, now, text);
 
-String MessagesTask::getOneStringFrom(std::vector<String> messages)
-{
-  int totalLen = 0;
-  for (auto oneMsg : messages)
-    totalLen += oneMsg.length();
-  String toReturn;
-  toReturn.reserve(totalLen+1);
-  for (auto oneMsg : messages)
-    toReturn.concat(oneMsg);
-  return toReturn;
+    std::map<String, String> m = {
+      {F("id"), String(e.id)},
+      {F("priority"), String(e.priority)},
+      {F("config"), (e.flags & MessageStore::FROM_CONFIG) ? F(", config"): F("")},
+      {F("text"), text.buffer},
+    };
+
+    ss.reset();
+    macroStringReplace(messagesRowFS, mapLookup(m), ss);
+    webServer.sendContent(ss.buffer);
+  }
+
+  ss.reset();
+  macroStringReplace(messagesFooterFS, constString(String(page + 1)), ss);
+  webServer.sendContent(ss.buffer);
+  webServer.chunkedResponseFinalize();
 }
@@ -13,6 +13,10 @@
 #include <time_utils.h>
 #include <utils.h>
 #include <set>
+#include <ESP8266WebServer.h>
+#include "MessageStore.h"
+#include "MacroStringReplace.h"
+#include "WorkItem.h"
 
 const static DeltaTimePrecision allowedPrecisions[] = {DeltaTimePrecision::DAYS,
 														DeltaTimePrecision::HOURS,
@@ -29,12 +33,36 @@ class MessagesTask: public Tasks::Task
 	private:
     void updateFromConfig();
     String getMessages();
-    String getMessage(String messageKey);
-	String getOneStringFrom(std::vector<String> messages);
 
-	std::vector<String> messageKeys;
+    void handlePage(ESP8266WebServer& webServer);
+
+    MessageStore store;
+
+    //"All messages" - rendered in the background one entry per step,
+    //every entry is read from the flash
+    class AllMessages: public WorkItem
+    {
+      public:
+        AllMessages(const MessageStore& store): store(store) {}
+        void start();
+
+        String text;      //the last complete one
+
+      protected:
+        virtual bool step();
+
+      private:
+        const MessageStore& store;
+        StringStream pending;
+        String split;
+        time_t now = 0;
+        size_t index = 0;
+    };
+
+    AllMessages allMessages;
 
     size_t messageCycleIndex = 0;
+    bool configChanged = true;
 };
 
 #endif /* MESSAGESTASK_H_ */
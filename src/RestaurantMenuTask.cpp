@@ -13,6 +13,11 @@
 #include "utils.h"
 #include "time.h"
 #include "config.h"
+#include "TraceRecorder.h"
+#include "ConfigSchema.h"
+#include "DataStore.h"
+#include "Variables.h"
+#include "WorkItem.h"
 #include <vector>
 #include <set>
 
@@ -36,12 +41,9 @@ static const char menuStatusPage[] PROGMEM = R"_(
 FlashStream menuStatusPageFS(menuStatusPage);
 
 #define MAX_DISHES 10
-#define MENU_FETCH_INTERVAL_S 900_s
+#define MENU_FETCH_INTERVAL_MS 900000
 #define DISPLAY_PERIOD 0.025_s
 
-#define DEFAULT_MENU_START_HOUR 9
-#define DEFAULT_MENU_END_HOUR 14
-
 namespace Tasks {
 
 static const struct {
@@ -145,6 +147,20 @@ static String trimmedKeyWords(const String& dish, int maxWords = 4) {
 RestaurantMenuTask::RestaurantMenuTask() {
     addRegularMessage({this, [this]() {return getMenuString(); }, DISPLAY_PERIOD, 1, true});
     registerPage("menu", "Restaurant menu", [this](ESP8266WebServer& ws) {handleStatusPage(ws);});
+    Variables::addText(F("menu.date"), [this]() {return cachedMenuDate;});
+    Variables::addText(F("menu.text"), [this]() {return cachedMenuLine;});
+    Variables::addInt(F("menu.dishes"), [this]() {return (int32_t)dishes.size();});
+
+    updateFromConfig();
+    //a changed setting is applied at once, the menu is fetched again
+    for (auto f: {Config::RESTAURANT, Config::MENU_START_HOUR, Config::MENU_END_HOUR, Config::MENU_SHOW_TOMORROW})
+    {
+        DataStore::subscribe(Config::getKey(f), [this](const String&) {
+            updateFromConfig();
+            lastFetchedMenuDate = String();
+            wakeTask(this);
+        });
+    }
 }
 
 String RestaurantMenuTask::makeMenuDateString(time_t base) const {
@@ -154,18 +170,14 @@ String RestaurantMenuTask::makeMenuDateString(time_t base) const {
     return String(buf);
 }
 
-void RestaurantMenuTask::updateMenuHoursFromConfig() {
-    int startHour = readConfigWithDefault(F("menuStartHour"), String(DEFAULT_MENU_START_HOUR).c_str()).toInt();
-    if (startHour >= 0 && startHour <= 23)
-        menuStartHour = startHour;
-    else
-        menuStartHour = DEFAULT_MENU_START_HOUR;
+void RestaurantMenuTask::updateFromConfig() {
+    //checked when the configuration is loaded
+    menuStartHour = Config::getInt(Config::MENU_START_HOUR);
+    menuEndHour = Config::getInt(Config::MENU_END_HOUR);
+    menuShowTomorrow = Config::getBool(Config::MENU_SHOW_TOMORROW);
 
-    int endHour = readConfigWithDefault(F("menuEndHour"), String(DEFAULT_MENU_END_HOUR).c_str()).toInt();
-    if (endHour >= 0 && endHour <= 23)
-        menuEndHour = endHour;
-    else
-        menuEndHour = DEFAULT_MENU_END_HOUR;
+    restaurantCode = codeSanitize(Config::getInt(Config::RESTAURANT));
+    restaurantId = codeToId(restaurantCode);
 }
 
 bool RestaurantMenuTask::isWithinDisplayHour() const {
@@ -179,15 +191,8 @@ bool RestaurantMenuTask::isWithinDisplayHour() const {
         return hour >= menuStartHour || hour < menuEndHour;
 }
 
-void RestaurantMenuTask::run() {
-    updateMenuHoursFromConfig();
-
-    int code = readConfigWithDefault(F("restaurant"), "3").toInt();
-    restaurantCode = codeSanitize(code);
-    restaurantId = codeToId(restaurantCode);
-
-    menuShowTomorrow = readConfigWithDefault(F("menuShowTomorrow"), "0").toInt() == 1;
-
+//the date of the menu to fetch, empty if the one we have is still good
+String RestaurantMenuTask::menuDateToFetch() {
     time_t now = time(nullptr);
     struct tm* t = localtime(&now);
     int hour = t->tm_hour;
@@ -204,109 +209,148 @@ void RestaurantMenuTask::run() {
 
     bool menuBoundary = (lastFetchedMenuDate != activeMenuDate);
     bool hourBoundary = (lastFetchHour != hour);
-    if (menuBoundary || hourBoundary) {
-        lastFetchedMenuDate = activeMenuDate;
-        lastFetchHour = hour;
-        fetchMenu(activeMenuDate);
+    if (!menuBoundary && !hourBoundary)
+        return String();
+
+    lastFetchedMenuDate = activeMenuDate;
+    lastFetchHour = hour;
+    return activeMenuDate;
+}
+
+void RestaurantMenuTask::run() {
+    CO_BEGIN();
+
+    fetchDate = menuDateToFetch();
+    for (fetchAttempts = 0; fetchDate.length() && fetchAttempts < 3; ++fetchAttempts) {
+        if (fetchAttempts)
+            CO_AWAIT_SLEEP(2000);
+
+        // the connect is blocking, the dishes are parsed in short steps as they arrive
+        httpCode = startFetch(fetchDate);
+        if (httpCode == 200) {
+            while (!readDishes()) {
+                CO_AWAIT_READABLE(*stream, HTTP_TIMEOUT_MS);
+                if (coTimedOut) {
+                    logPrintfX(F("RMT"), F("Menu response timed out"));
+                    break;
+                }
+            }
+            storeDishes(fetchDate);
+        } else {
+            logPrintfX(F("RMT"), F("HTTP GET failed with code %d, no menu fetched"), httpCode);
+        }
+        http.end();
+
+        if (httpCode != -1)
+            break;
     }
 
-    sleep(MENU_FETCH_INTERVAL_S);
+    sleepPeriodic(this, MENU_FETCH_INTERVAL_MS);
+
+    CO_END();
 }
 
-void RestaurantMenuTask::fetchMenu(const String& dateStr) {
+// one attempt, returns the HTTP code, the response is read by readDishes
+int RestaurantMenuTask::startFetch(const String& dateStr) {
     logPrintfX(F("RMT"), F("Starting fetchMenu for date: %s restaurant: %s"), dateStr.c_str(), restaurantId.c_str());
     dishes.clear();
-    std::set<String> seen;
+    seen.clear();
+    inList = false;
     String url = "https://api.mynovae.ch/en/api/v2/salepoints/" + restaurantId + "/menus/" + dateStr;
 
-    WiFiClientSecure client; client.setInsecure();
-    HTTPClient http;
+    client.setInsecure();
     http.begin(client, url);
     http.useHTTP10(true);
     http.addHeader("Novae-Codes", novaeKey);
     http.addHeader("Accept", "application/json");
     http.addHeader("X-Requested-With", "xmlhttprequest");
 
-    int httpCode = -1, attempts = 3;
-    while (attempts-- && httpCode == -1) {
-        httpCode = http.GET();
-        if (httpCode == -1) {
-            logPrintfX(F("RMT"), F("Fetching Menu returned HTTP Error %d"), httpCode);
-            sleep(2_s);
-        }
-    }
+    static uint16_t traceGet = Trace::registerName(F("menu.get"));
+    Trace::Scope scope(traceGet);
+    int code = http.GET();
+    stream = http.getStreamPtr();
+    return code;
+}
+
+// parses the dishes that have arrived, true when the list or the response ended
+bool RestaurantMenuTask::readDishes() {
+    static uint16_t traceParse = Trace::registerName(F("menu.parse"));
+    Trace::Scope scope(traceParse);
+    SliceBudget budget;
 
-    if (httpCode == 200) {
-        WiFiClient* stream = http.getStreamPtr();
-        while (stream->available()) {
-            char c = stream->peek();
-            if (c == '[') { stream->read(); break; }
-            if (isspace(c)) stream->read(); else break;
+    while (stream->available()) {
+        if (budget.expired()) return false;
+
+        char c = stream->peek();
+        if (!inList) {
+            if (isspace(c)) { stream->read(); continue; }
+            if (c == '[') stream->read();
+            inList = true;
+            continue;
         }
-        while (stream->available()) {
-            char c = stream->peek();
-            if (isspace(c) || c == ',') { stream->read(); continue; }
-            if (c == ']') { stream->read(); break; }
-            if (c != '{') { stream->read(); continue; }
-
-            StaticJsonDocument<768> doc;
-            StaticJsonDocument<64> filter;
-            filter["title"] = true;
-            filter["model"]["service"] = true;
-
-            DeserializationError err = deserializeJson(doc, *stream, DeserializationOption::Filter(filter));
-
-            if (!err) {
-                // filter lunch menu only "midi"
-                const char* service = doc["model"]["service"];
-                if (!service) continue;
-                String serviceStr(service);
-                serviceStr.toLowerCase();
-                if (serviceStr != "midi") continue;
-
-                JsonObject title = doc["title"];
-                String dish;
-                if (title.containsKey("en") && strlen(title["en"])) dish = String(title["en"].as<const char*>());
-                else if (title.containsKey("fr") && strlen(title["fr"])) dish = String(title["fr"].as<const char*>());
-                if (dish.length()) {
-                    String tmp = trimmedKeyWords(normalizeFrenchText(dish), 4);
-                    if (tmp.length() && seen.find(tmp) == seen.end()) {
-                        seen.insert(tmp);
-                        dishes.push_back(tmp);
-                        logPrintfX(F("RMT"), F("Added dish: %s"), tmp.c_str());
-                    }
-                }
-            } else {
-                int depth = 0;
-                while (stream->available()) {
-                    char cc = stream->read();
-                    if (cc == '{') depth++;
-                    if (cc == '}') { if (depth == 0) break; depth--; }
+        if (isspace(c) || c == ',') { stream->read(); continue; }
+        if (c == ']') { stream->read(); return true; }
+        if (c != '{') { stream->read(); continue; }
+
+        // a dish that arrived in part waits for the rest within the stream's timeout
+        StaticJsonDocument<768> doc;
+        StaticJsonDocument<64> filter;
+        filter["title"] = true;
+        filter["model"]["service"] = true;
+
+        DeserializationError err = deserializeJson(doc, *stream, DeserializationOption::Filter(filter));
+
+        if (!err) {
+            // filter lunch menu only "midi"
+            const char* service = doc["model"]["service"];
+            if (!service) continue;
+            String serviceStr(service);
+            serviceStr.toLowerCase();
+            if (serviceStr != "midi") continue;
+
+            JsonObject title = doc["title"];
+            String dish;
+            if (title.containsKey("en") && strlen(title["en"])) dish = String(title["en"].as<const char*>());
+            else if (title.containsKey("fr") && strlen(title["fr"])) dish = String(title["fr"].as<const char*>());
+            if (dish.length()) {
+                String tmp = trimmedKeyWords(normalizeFrenchText(dish), 4);
+                if (tmp.length() && seen.find(tmp) == seen.end()) {
+                    seen.insert(tmp);
+                    dishes.push_back(tmp);
+                    logPrintfX(F("RMT"), F("Added dish: %s"), tmp.c_str());
                 }
             }
-        }
-
-        logPrintfX(F("RMT"), F("Fetch menu completed"));
-
-        String allDishes;
-        if (dishes.empty()) {
-            cachedMenuLine = "";
-            logPrintfX(F("RMT"), F("No dishes found for date %s"), dateStr.c_str());
         } else {
-            String allDishes;
-            for (auto& dish : dishes) {
-                if (!allDishes.isEmpty()) allDishes += " | ";
-                allDishes += dish;
+            int depth = 0;
+            while (stream->available()) {
+                char cc = stream->read();
+                if (cc == '{') depth++;
+                if (cc == '}') { if (depth == 0) break; depth--; }
             }
-            cachedMenuLine = allDishes;
-            cachedMenuDate = dateStr;
         }
+    }
+
+    return !stream->connected();
+}
 
-        lastStatusTimestamp = getDateTime();
+void RestaurantMenuTask::storeDishes(const String& dateStr) {
+    logPrintfX(F("RMT"), F("Fetch menu completed"));
+
+    if (dishes.empty()) {
+        cachedMenuLine = "";
+        logPrintfX(F("RMT"), F("No dishes found for date %s"), dateStr.c_str());
     } else {
-        logPrintfX(F("RMT"), F("HTTP GET failed with code %d, no menu fetched"), httpCode);
+        String allDishes;
+        for (auto& dish : dishes) {
+            if (!allDishes.isEmpty()) allDishes += " | ";
+            allDishes += dish;
+        }
+        cachedMenuLine = allDishes;
+        cachedMenuDate = dateStr;
     }
-    http.end();
+    seen.clear();
+
+    lastStatusTimestamp = getDateTime();
 }
 
 String RestaurantMenuTask::getMenuString() const {
@@ -13,10 +13,13 @@
 #include <vector>
 #include <set>
 #include <ESP8266WebServer.h>
+#include <ESP8266HTTPClient.h>
+#include <ESP8266WiFi.h>
+#include "Coroutine.h"
 
 namespace Tasks {
 
-class RestaurantMenuTask : public Task {
+class RestaurantMenuTask : public Task, public Coroutine {
 public:
     RestaurantMenuTask();
 
@@ -26,9 +29,12 @@ public:
     void handleStatusPage(ESP8266WebServer& webServer);
 
 private:
-    void fetchMenu(const String& dateStr);
+    int startFetch(const String& dateStr);
+    bool readDishes();
+    void storeDishes(const String& dateStr);
+    String menuDateToFetch();
     String makeMenuDateString(time_t base) const;
-    void updateMenuHoursFromConfig();
+    void updateFromConfig();
     bool isWithinDisplayHour() const;
 
     int restaurantCode = 1;
@@ -44,6 +50,17 @@ private:
     String lastFetchedMenuDate;
     int lastFetchHour = -1;
 
+    String fetchDate;
+    int fetchAttempts = 0;
+
+    // state of the request in progress
+    WiFiClientSecure client;
+    HTTPClient http;
+    WiFiClient* stream = nullptr;
+    int httpCode = 0;
+    bool inList = false;    // the '[' of the dishes was read
+    std::set<String> seen;
+
     std::vector<String> dishes;
 
     // Status page fields
@@ -6,10 +6,12 @@
 #include <LEDMatrixDriver.hpp>
 #include "SDD.hpp"
 #include "config.h"
+#include "TraceRecorder.h"
 
 using namespace std;
 
 SDD::SDD(LEDMatrixDriver &ledMatrixDriver):
+						renderer(*this),
 						buffer(ledMatrixDriver.getSegments() * 8),
 						ledMatrixDriver(ledMatrixDriver),  
 						physicalDisplayLen(ledMatrixDriver.getSegments() * 8)
@@ -62,41 +64,102 @@ bool SDD::tick()
 
 void SDD::renderString(const String &message, const PyFont& font)
 {
-	size_t len = calculateRenderedLength(font, message.c_str());
+	startRender(message, font);
+	while (!renderSlice());
+}
+
+void SDD::startRender(const String &message, const PyFont& font)
+{
+	renderer.start(message.c_str(), font);
+}
+
+size_t SDD::layoutText(size_t len)
+{
 	startColumn = 0;
 
 	//here we make difference between a text that fits in the display and a text
 	//that has to be scrolled
 	if (len <= physicalDisplayLen)
 	{
-		buffer.resize(physicalDisplayLen);               //resize and zero
+		buffer.assign(physicalDisplayLen, 0);		//resize and zero
+		return (physicalDisplayLen - len + 1) / 2;	//calculate margin with rounding
+	}
+
+	//just change the size, the values will be initialized anyway when rendering
+	buffer.resize(len);
+	return 0;
+}
 
-		for (auto& e: buffer)
-			e = 0;
+void SDD::showRenderedText()
+{
+	//a text that fits stays still, the other one starts scrolling after the delay
+	state = buffer.size() > physicalDisplayLen ? STATE::START: STATE::END;
+	delayCounter = endDelay;
 
-		int margin = (physicalDisplayLen - len + 1) / 2;    //calculate margin with rounding
+	refreshDisplay();
+}
+
+void SDD::Renderer::start(const char* text, const PyFont& font)
+{
+	this->text = text;
+	this->font = &font;
+	position = 0;
+	length = 0;
+	measured = false;
+	restartWork();
+}
 
-		renderText(font, message.c_str(), buffer.data() + margin, len);
+bool SDD::Renderer::step()
+{
+	if (!measured)
+	{
+		for (uint8_t i = 0; i < charsPerStep && text[position]; ++i)
+			length += font->getCharWidth(text[position++]);
 
-		state = STATE::END;
-		delayCounter = endDelay;
+		if (text[position])
+			return false;
 
-		refreshDisplay();
-		return;
+		measured = true;
+		position = 0;
+		output = sdd.layoutText(length);
+		end = output + length;
+		return false;
 	}
 
-	//just change the size, the values will be initialized anyway when rendering
-	buffer.resize(len);
-	renderText(font, message.c_str(), buffer.data(), len);
+	for (uint8_t i = 0; i < charsPerStep && text[position] && output < end; ++i)
+		output += renderChar(*font, text[position++], sdd.buffer.data() + output, end - output);
+
+	if (text[position] && output < end)
+		return false;
+
+	sdd.showRenderedText();
+	return true;
+}
 
-	state = STATE::START;
+size_t SDD::getScrollLength() const
+{
+	if (buffer.size() <= physicalDisplayLen)
+		return 0;
+
+	return buffer.size() - physicalDisplayLen;
+}
+
+void SDD::setEndDelay(int ticks)
+{
+	endDelay = ticks > 0 ? ticks: 1;
 	delayCounter = endDelay;
+}
 
-	refreshDisplay();
+int SDD::getStillTicks() const
+{
+	return state == STATE::MIDDLE ? 0: delayCounter;
 }
 
 void SDD::refreshDisplay()
 {
+	static uint16_t traceId = Trace::registerName(F("spi"));
+	Trace::Scope scope(traceId);
+
 	for (uint32_t  i = 0; i < physicalDisplayLen; ++i)
 	{
 		ledMatrixDriver.setColumn(i, buffer[i+startColumn]);
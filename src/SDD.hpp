@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 #include "pyfont.h"
+#include "WorkItem.h"
 // Scrolling Display Driver (SDD)
 // Class for the state machine that handles the scrolling of the
 // text on the screens
@@ -19,9 +20,48 @@ class SDD
 
 		bool tick();
 		void renderString(const String &message, const PyFont& font);
+		//the same in slices for the long texts: startRender once, then renderSlice
+		//in every pass till it returns true, the message can't change till then
+		void startRender(const String &message, const PyFont& font);
+		bool renderSlice() {return renderer.runSlice();}
 		void refreshDisplay();
 
+		//number of columns the text has to travel, 0 if it fits the display
+		size_t getScrollLength() const;
+		//ticks spent at the start and at the end of the text, call after renderString
+		void setEndDelay(int ticks);
+		//ticks left before the display changes, 0 while scrolling
+		int getStillTicks() const;
+
 	private:
+		//measures the text and then renders it into the buffer, a few characters per step
+		class Renderer: public WorkItem
+		{
+			public:
+				Renderer(SDD& sdd): sdd(sdd) {}
+				void start(const char* text, const PyFont& font);
+
+			protected:
+				virtual bool step();
+
+			private:
+				const static uint8_t charsPerStep = 16;
+
+				SDD& sdd;
+				const char* text = nullptr;
+				const PyFont* font = nullptr;
+				size_t position = 0;
+				size_t length = 0;
+				size_t output = 0;
+				size_t end = 0;
+				bool measured = false;
+		};
+
+		//sizes the buffer for a text of len columns, returns the column it starts at
+		size_t layoutText(size_t len);
+		void showRenderedText();
+
+		Renderer renderer;
 		std::vector<uint8_t> buffer;
 		enum class STATE
 		{
@@ -36,7 +76,8 @@ class SDD
 		const static int columnIncrement = 1;
 		size_t           startColumn = 0;
 
-		const static int endDelay = 20;
+		const static int defaultEndDelay = 20;
+		int              endDelay = defaultEndDelay;
 		int              delayCounter = 0;
 		uint32_t         physicalDisplayLen;
 };
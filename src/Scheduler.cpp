@@ -0,0 +1,626 @@
+/*
+ * Scheduler.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include <vector>
+#include <algorithm>
+
+#include "Arduino.h"
+
+#include "Scheduler.h"
+#include "config.h"
+#include "TraceRecorder.h"
+#include "StallWatchdog.h"
+
+static uint64_t idleWindowEnd = 0;
+
+//index of the task in the middle of its run, -1 outside of run()
+static int runningTask = -1;
+
+//readiness gates, the ones opened from the SNTP callback are applied by the scheduler
+static uint8_t openGates = 0;
+static volatile uint8_t pendingGates = 0;
+
+//set when a task was found killed, the descriptors are swept after the pass
+static bool killedTasks = false;
+
+std::vector<TaskDescriptor>& getTasks()
+{
+	static std::vector<TaskDescriptor> tasks;
+	return tasks;
+}
+
+//wake-up times of the tasks kept as a min-heap, only the due ones are touched
+//times are micros64() - they don't wrap and keep the sub-millisecond part
+struct WakeUp
+{
+	uint64_t time;
+	uint16_t index;
+	uint16_t generation;
+};
+
+static std::vector<WakeUp>& wakeUps()
+{
+	static std::vector<WakeUp> heap;
+	return heap;
+}
+
+static bool wakesLater(const WakeUp& a, const WakeUp& b)
+{
+	return a.time > b.time;
+}
+
+static void dropStaleWakeUps()
+{
+	auto& heap = wakeUps();
+	const auto& tasks = getTasks();
+
+	heap.erase(std::remove_if(heap.begin(), heap.end(), [&tasks](const WakeUp& w)
+	{
+		const auto& td = tasks[w.index];
+		return !td.armed || td.generation != w.generation;
+	}), heap.end());
+
+	std::make_heap(heap.begin(), heap.end(), wakesLater);
+}
+
+static void armTask(size_t index, uint64_t time)
+{
+	auto& td = getTasks()[index];
+	td.wakeUp = time;
+	td.generation++;
+	td.armed = true;
+	td.parked = false;
+
+	auto& heap = wakeUps();
+	heap.push_back({time, (uint16_t)index, td.generation});
+	std::push_heap(heap.begin(), heap.end(), wakesLater);
+
+	//wakeTask leaves the old entries behind, get rid of them once in a while
+	if (heap.size() > 2 * getTasks().size() + 8)
+		dropStaleWakeUps();
+}
+
+//upper limits of the histogram bins (us)
+static const uint32_t histogramLimits[TaskStats::BINS - 1] = {100, 1000, 10000, 100000, 1000000};
+
+//runs the task and updates its statistics, returns the number of CPU cycles it took
+static uint32_t runTask(size_t index)
+{
+	uint32_t now = millis();
+	uint16_t traceId = getTasks()[index].traceId;
+	uint64_t late = micros64() - getTasks()[index].wakeUp;
+
+	runningTask = index;
+	StallWatchdog::currentTask = traceId;
+	Trace::begin(traceId);
+	uint32_t start = ESP.getCycleCount();
+	Tasks::Task* t = getTasks()[index].task;
+	getTasks()[index].shortRun = false;
+	//a reset may connect - it belongs to the run, in the task's own slot
+	if (getTasks()[index].resetPending)
+	{
+		getTasks()[index].resetPending = false;
+		t->reset();
+	}
+	if (t->getState() == Tasks::State::READY)
+		t->run();
+	uint32_t cycles = ESP.getCycleCount() - start;
+	Trace::end(traceId);
+	StallWatchdog::currentTask = StallWatchdog::NO_TASK;
+	runningTask = -1;
+
+	//the vector may have grown during the run, take the reference again
+	auto& stats = getTasks()[index].stats;
+	uint32_t lateUs = std::min<uint64_t>(late, UINT32_MAX);
+	stats.lateAvg = stats.calls ? (stats.lateAvg * 7 + lateUs) / 8: lateUs;
+	stats.lateMax = std::max(stats.lateMax, lateUs);
+	stats.calls++;
+	stats.totalCycles += cycles;
+	stats.maxCycles = std::max(stats.maxCycles, cycles);
+	stats.lastRun = now;
+
+	uint32_t mhz = ESP.getCpuFreqMHz();
+	uint8_t bin = 0;
+	while (bin < TaskStats::BINS - 1 && cycles >= histogramLimits[bin] * mhz)
+		bin++;
+	stats.histogram[bin]++;
+
+	return cycles;
+}
+
+//CPPTasks keeps the remaining sleep in a private tick counter.
+//It is drained once here, so the wake-up time can be kept in the heap
+//and no task has to be updated on every tick.
+static uint32_t takeSleepTicks(Tasks::Task* t)
+{
+	uint32_t ticks = 0;
+	while (t->getState() == Tasks::State::SLEEPING)
+	{
+		updateSleepSingle(t);
+		ticks++;
+	}
+	return ticks;
+}
+
+//one period after the deadline - less than a period behind runs again right away
+//to catch up, more than that drops the missed runs but keeps the phase
+static uint64_t nextPeriod(TaskDescriptor& td, uint64_t deadline, uint64_t period, uint64_t now)
+{
+	uint64_t next = deadline + period;
+	if (next + period <= now)
+	{
+		uint64_t missed = (now - next) / period;
+		td.stats.missed += missed;
+		next += missed * period;
+	}
+	return next;
+}
+
+//puts the task back into the heap according to its state,
+//a wake-up time requested with sleepFor/sleepPeriodic wins over Task::sleep
+static void rearmTask(size_t index, uint64_t now, bool ran = false)
+{
+	auto& td = getTasks()[index];
+	bool requested = td.wakeUpRequested;
+	td.armed = false;
+	td.wakeUpRequested = false;
+
+	uint64_t time;
+	switch (td.task->getState())
+	{
+		case Tasks::State::READY:
+			time = requested ? td.nextWakeUp: now;
+			break;
+
+		case Tasks::State::SLEEPING:
+		{
+			uint64_t ticks = takeSleepTicks(td.task);
+			time = requested ? td.nextWakeUp: now + ticks * MS_PER_CYCLE * 1000;
+			break;
+		}
+
+		case Tasks::State::KILLED:
+			killedTasks = true;
+			return;
+
+		default:
+			//suspended tasks wait for wakeTask
+			return;
+	}
+
+	//the period set at run time replaces the long sleeps, the short ones are steps of a longer job
+	if (ran && td.periodOverride && time >= now + TASK_PERIOD_OVERRIDE_MIN * 1000ULL)
+		time = nextPeriod(td, td.wakeUp, td.periodOverride * 1000ULL, now);
+
+	armTask(index, time);
+}
+
+void addTask(const TaskDescriptor& td)
+{
+	getTasks().emplace_back(td);
+	getTasks().back().traceId = Trace::registerName(td.name.length() ? td.name: String(F("task")));
+	rearmTask(getTasks().size() - 1, micros64());
+}
+
+Tasks::Task* addTask(Tasks::Task* t, uint8_t flags, const String& name)
+{
+	addTask(TaskDescriptor(t, flags, name));
+	return t;
+}
+
+void wakeTask(Tasks::Task* t)
+{
+	t->resume();
+
+	auto& tasks = getTasks();
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		if (tasks[i].task == t)
+		{
+			//woken from outside (often after a reset), it's not the short step it asked for
+			tasks[i].shortRun = false;
+			//slow tasks waiting in the queue are already due
+			if (!tasks[i].queued)
+				armTask(i, micros64());
+			return;
+		}
+	}
+}
+
+static int findTask(Tasks::Task* t)
+{
+	auto& tasks = getTasks();
+	if (runningTask != -1 && tasks[runningTask].task == t)
+		return runningTask;
+
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		if (tasks[i].task == t)
+			return i;
+	}
+	return -1;
+}
+
+static int findTask(const String& name)
+{
+	auto& tasks = getTasks();
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		if (tasks[i].name == name)
+			return i;
+	}
+	return -1;
+}
+
+//the user's run time control doesn't touch the system tasks
+static int findControlledTask(const String& name)
+{
+	int index = findTask(name);
+	if (index == -1 || (getTasks()[index].flags & TaskDescriptor::SYSTEM))
+		return -1;
+	return index;
+}
+
+static void requestWakeUp(int index, uint64_t time)
+{
+	auto& td = getTasks()[index];
+
+	//from inside run() - applied by rearmTask when the run is over
+	if (index == runningTask)
+	{
+		td.nextWakeUp = time;
+		td.wakeUpRequested = true;
+		return;
+	}
+
+	armTask(index, time);
+}
+
+void sleepFor(Tasks::Task* t, uint32_t ms)
+{
+	int index = findTask(t);
+	if (index == -1)
+		return;
+
+	requestWakeUp(index, micros64() + ms * 1000ULL);
+}
+
+void sleepPeriodic(Tasks::Task* t, uint32_t ms)
+{
+	int index = findTask(t);
+	if (index == -1 || ms == 0)
+		return;
+
+	auto& td = getTasks()[index];
+	uint64_t now = micros64();
+
+	//counted from the deadline of this run, not from its end
+	requestWakeUp(index, nextPeriod(td, index == runningTask ? td.wakeUp: now, ms * 1000ULL, now));
+}
+
+void idleUntilNextTask(uint32_t maxIdle)
+{
+	const auto& heap = wakeUps();
+
+	uint32_t idle = maxIdle;
+	if (heap.size())
+	{
+		uint64_t now = micros64();
+		uint64_t next = heap.front().time;
+		idle = next > now ? std::min<uint64_t>((next - now + 999) / 1000, maxIdle): 0;
+	}
+
+	if (idle)
+		delay(idle);
+}
+
+//slow tasks that are due, in the order of their deadlines
+static std::vector<uint16_t>& slowQueue()
+{
+	static std::vector<uint16_t> queue;
+	return queue;
+}
+
+void announceIdleWindow(uint32_t ms)
+{
+	idleWindowEnd = micros64() + ms * 1000ULL;
+}
+
+void nextRunIsShort(Tasks::Task* t)
+{
+	int index = findTask(t);
+	if (index != -1)
+		getTasks()[index].shortRun = true;
+}
+
+//a pending reset starts the task over, that is not a short step
+static bool needsIdleWindow(const TaskDescriptor& td)
+{
+	return (td.flags & TaskDescriptor::SLOW) && (!td.shortRun || td.resetPending);
+}
+
+static void queueSlowTask(size_t index)
+{
+	auto& tasks = getTasks();
+	auto& queue = slowQueue();
+	tasks[index].queued = true;
+
+	auto it = std::upper_bound(queue.begin(), queue.end(), index, [&tasks](uint16_t a, uint16_t b)
+	{
+		return tasks[a].wakeUp < tasks[b].wakeUp;
+	});
+	queue.insert(it, index);
+}
+
+static bool fitsIdleWindow(const TaskDescriptor& td, uint64_t now)
+{
+	if (idleWindowEnd <= now)
+		return false;
+
+	uint64_t window = idleWindowEnd - now;
+
+	//never measured - the old rule of one second of a still display
+	if (td.costMax == 0 ? window >= 1000000: td.costMax < window)
+		return true;
+
+	//it has waited long enough, let it stall the display a bit (the long
+	//jobs are split into coroutine steps so this stays rare)
+	return td.wakeUp + SLOW_TASK_MAX_WAIT * 1000ULL < now;
+}
+
+//all its gates are open and it is not paused
+static bool canRun(const TaskDescriptor& td)
+{
+	uint8_t gates = td.flags & TaskDescriptor::GATES;
+	return !td.paused && (gates & openGates) == gates;
+}
+
+void openGate(uint8_t gates)
+{
+	if ((openGates & gates) == gates)
+		return;
+
+	openGates |= gates;
+
+	auto& tasks = getTasks();
+	uint64_t now = micros64();
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		if (tasks[i].parked && canRun(tasks[i]))
+			armTask(i, now);
+	}
+}
+
+void closeGate(uint8_t gates)
+{
+	//the tasks are parked when they are due next time
+	openGates &= ~gates;
+}
+
+bool isGateOpen(uint8_t gates)
+{
+	return (openGates & gates) == gates;
+}
+
+void openGateLater(uint8_t gates)
+{
+	pendingGates |= gates;
+}
+
+bool pauseTask(const String& name, bool paused)
+{
+	int index = findControlledTask(name);
+	if (index == -1)
+		return false;
+
+	auto& td = getTasks()[index];
+	td.paused = paused;
+
+	//a slow task waiting for an idle window leaves the queue at once
+	if (paused && td.queued)
+	{
+		auto& queue = slowQueue();
+		queue.erase(std::find(queue.begin(), queue.end(), index));
+		td.queued = false;
+		td.parked = true;
+	}
+
+	//a paused task is parked when it is due, a resumed one runs right away
+	if (!paused && td.parked && canRun(td))
+		armTask(index, micros64());
+
+	return true;
+}
+
+bool resetTask(const String& name)
+{
+	int index = findTask(name);
+	if (index == -1)
+		return false;
+
+	auto& td = getTasks()[index];
+	td.resetPending = true;
+	wakeTask(td.task);
+	return true;
+}
+
+bool setTaskPeriod(const String& name, uint32_t ms)
+{
+	int index = findControlledTask(name);
+	if (index == -1)
+		return false;
+
+	//a shorter period would run the fetchers (a connect each) on almost every pass
+	if (ms && ms < TASK_PERIOD_OVERRIDE_MIN)
+		ms = TASK_PERIOD_OVERRIDE_MIN;
+
+	auto& td = getTasks()[index];
+	td.periodOverride = ms;
+
+	//don't wait for the old, longer period to pass
+	uint64_t next = micros64() + ms * 1000ULL;
+	if (ms && td.armed && next < td.wakeUp)
+		armTask(index, next);
+
+	return true;
+}
+
+static void runSlowTask(size_t index)
+{
+	uint32_t cost = runTask(index) / ESP.getCpuFreqMHz();
+
+	auto& td = getTasks()[index];
+	td.costAvg = td.costAvg ? (td.costAvg * 7 + cost) / 8: cost;
+	td.costMax = std::max(cost, td.costMax - td.costMax / 16);
+
+	rearmTask(index, micros64(), true);
+}
+
+static void runSlowTasks()
+{
+	auto& queue = slowQueue();
+
+	for (size_t i = 0; i < queue.size();)
+	{
+		uint64_t now = micros64();
+		if (idleWindowEnd < now)
+			return;
+
+		uint16_t index = queue[i];
+		auto& td = getTasks()[index];
+
+		//a gate closed or paused while waiting
+		if (!canRun(td))
+		{
+			td.queued = false;
+			td.parked = true;
+			queue.erase(queue.begin() + i);
+			continue;
+		}
+
+		//suspended or put to sleep by someone else while waiting
+		if (td.task->getState() != Tasks::State::READY)
+		{
+			td.queued = false;
+			queue.erase(queue.begin() + i);
+			rearmTask(index, now);
+			continue;
+		}
+
+		//the earlier ones that don't fit stay in the queue
+		if (!fitsIdleWindow(td, now))
+		{
+			++i;
+			continue;
+		}
+
+		td.queued = false;
+		queue.erase(queue.begin() + i);
+		runSlowTask(index);
+	}
+}
+
+//forgets the killed tasks, the indices change so the heap and the queue are rebuilt
+//(the task objects belong to whoever created them)
+static void sweepKilledTasks()
+{
+	killedTasks = false;
+
+	auto& tasks = getTasks();
+	std::vector<int> newIndex(tasks.size(), -1);
+	size_t kept = 0;
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		if (tasks[i].task->getState() == Tasks::State::KILLED)
+			continue;
+
+		newIndex[i] = kept;
+		if (i != kept)
+			tasks[kept] = std::move(tasks[i]);
+		kept++;
+	}
+	tasks.erase(tasks.begin() + kept, tasks.end());
+
+	auto& queue = slowQueue();
+	queue.erase(std::remove_if(queue.begin(), queue.end(), [&newIndex](uint16_t i) {return newIndex[i] == -1;}), queue.end());
+	for (auto& i: queue)
+		i = newIndex[i];
+
+	auto& heap = wakeUps();
+	heap.clear();
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		if (tasks[i].armed)
+			heap.push_back({tasks[i].wakeUp, (uint16_t)i, tasks[i].generation});
+	}
+	std::make_heap(heap.begin(), heap.end(), wakesLater);
+}
+
+void scheduleTasks()
+{
+	auto& tasks = getTasks();
+	auto& heap = wakeUps();
+	if (pendingGates)
+	{
+		uint8_t gates = pendingGates;
+		pendingGates = 0;
+		openGate(gates);
+	}
+
+	uint64_t now = micros64();
+
+	//take all the due tasks first, the ready ones are re-armed for "now"
+	static std::vector<uint16_t> due;
+	due.clear();
+
+	while (heap.size() && heap.front().time <= now)
+	{
+		WakeUp w = heap.front();
+		std::pop_heap(heap.begin(), heap.end(), wakesLater);
+		heap.pop_back();
+
+		auto& td = tasks[w.index];
+		if (!td.armed || td.generation != w.generation || td.queued)
+			continue;
+
+		td.armed = false;
+		due.push_back(w.index);
+	}
+
+	for (auto index: due)
+	{
+		auto& td = tasks[index];
+
+		//out of the heap till its gates open or it is resumed
+		if (!canRun(td))
+		{
+			td.parked = true;
+			continue;
+		}
+
+		if (td.task->getState() != Tasks::State::READY)
+		{
+			rearmTask(index, now);
+			continue;
+		}
+
+		if (needsIdleWindow(td))
+		{
+			//it will run when the display is still for long enough
+			queueSlowTask(index);
+			continue;
+		}
+
+		runTask(index);
+		rearmTask(index, micros64(), true);
+	}
+
+	runSlowTasks();
+
+	if (killedTasks)
+		sweepKilledTasks();
+}
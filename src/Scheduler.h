@@ -0,0 +1,114 @@
+/*
+ * Scheduler.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <vector>
+#include <tasks.hpp>
+#include "Arduino.h"
+
+// The scheduling core: wake-up heap, slow task queue, readiness gates and the
+// run time statistics. It needs nothing but the Tasks library and the clock,
+// so tools/schedsim builds it on the host as it is.
+
+//run time statistics, measured with the CPU cycle counter
+struct TaskStats
+{
+		const static uint8_t BINS = 6;			//<0.1ms, <1ms, <10ms, <100ms, <1s, more
+
+		uint32_t calls = 0;
+		uint64_t totalCycles = 0;
+		uint32_t maxCycles = 0;
+		uint32_t lastRun = 0;					//millis() at the start of the last run
+		uint32_t histogram[BINS] = {};
+		uint32_t lateAvg = 0;					//start of the run past its wake-up time (us), EWMA
+		uint32_t lateMax = 0;
+		uint32_t missed = 0;					//periodic runs dropped by sleepPeriodic
+};
+
+struct TaskDescriptor
+{
+		const static uint8_t ENABLED = 1;
+		const static uint8_t CONNECTED = 2;		//gate - Wi-Fi connected as a client
+		const static uint8_t SLOW = 4;
+		const static uint8_t TIME_SYNCED = 8;	//gate - the clock was set by SNTP
+		const static uint8_t FS_MOUNTED = 16;	//gate - LittleFS can be mounted
+		const static uint8_t SYSTEM = 32;		//the web server, display, timers... - can't be paused or slowed down
+		const static uint8_t GATES = CONNECTED | TIME_SYNCED | FS_MOUNTED;
+
+		TaskDescriptor(Tasks::Task* task, uint8_t flags, const String& name = String()):
+			task(task), flags(flags), name(name) {}
+
+		Tasks::Task* task;
+		uint8_t flags;
+		String name;
+		uint16_t traceId = 0;
+		TaskStats stats;
+
+		uint64_t wakeUp = 0;		//micros64() of the next run, valid only if armed
+		uint64_t nextWakeUp = 0;	//requested by sleepFor/sleepPeriodic during the run
+		bool	 wakeUpRequested = false;
+		uint16_t generation = 0;	//bumped on every re-arm, older heap entries are ignored
+		bool	 armed = false;
+		bool	 queued = false;		//slow task waiting for an idle window of the display
+		bool	 parked = false;		//due, but some of its gates are closed or it is paused
+		bool	 paused = false;		//by the user, independent of Task::suspend
+		uint32_t periodOverride = 0;	//ms set at run time, 0 - the task's own
+		bool	 resetPending = false;	//Task::reset at the start of the next run
+		bool	 shortRun = false;		//the next run of a slow task needs no idle window
+
+		uint32_t costAvg = 0;		//run time of slow tasks (us), EWMA
+		uint32_t costMax = 0;		//slowly decaying maximum
+};
+
+std::vector<TaskDescriptor>& getTasks();
+Tasks::Task* addTask(Tasks::Task* t, uint8_t flags = 0, const String& name = String());
+void addTask(const TaskDescriptor& td);
+void scheduleTasks();
+
+//resumes a suspended or sleeping task and makes it run in the next pass
+void wakeTask(Tasks::Task* t);
+
+//Readiness gates (TaskDescriptor::CONNECTED, TIME_SYNCED, FS_MOUNTED). A due task
+//whose gates are not all open is parked - it leaves the heap and costs nothing
+//until opening the last of its gates arms it again.
+void openGate(uint8_t gates);
+//for callbacks that may come in the middle of a task (SNTP), applied in the next pass
+void openGateLater(uint8_t gates);
+void closeGate(uint8_t gates);
+bool isGateOpen(uint8_t gates);
+
+//Run time control by the name of the task, false if there is no such task
+//or it is a SYSTEM one (pausing the web server locks out the page to resume it).
+//A paused task is parked whatever its state, so the task itself, the gates
+//or wakeTask can't restart it. The period replaces the sleeps of at least
+//TASK_PERIOD_OVERRIDE_MIN ms and is never shorter than that, 0 brings back the task's own.
+bool pauseTask(const String& name, bool paused);
+bool setTaskPeriod(const String& name, uint32_t ms);
+//Task::reset at the start of the task's next run, e.g. after its configuration
+//changed; the run is woken up, but waits for its gates and idle window as usual
+bool resetTask(const String& name);
+
+//The next run of a slow task is a short step (a coroutine polling its socket or
+//parsing what has arrived), it runs when it is due without an idle window. Called
+//from the task's own run(), the run after it waits for a window again.
+void nextRunIsShort(Tasks::Task* t);
+
+//the display will not change for the next ms milliseconds, slow tasks may run
+void announceIdleWindow(uint32_t ms);
+//sleeps till the next task is due, but not longer than maxIdle ms
+void idleUntilNextTask(uint32_t maxIdle);
+
+//Task::sleep counts 10 ms ticks in 16 bits (655 s at most) and starts at the end of the run.
+//These are exact and can be as long as needed. Called from the task's own run()
+//they replace any Task::sleep of that run.
+void sleepFor(Tasks::Task* t, uint32_t ms);
+//the next run one period after the deadline of the current one, so the runs don't drift
+void sleepPeriodic(Tasks::Task* t, uint32_t ms);
+
+#endif /* SCHEDULER_H_ */
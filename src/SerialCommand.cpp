@@ -9,11 +9,20 @@
 #include <utils.h>
 #include <DataStore.h>
 #include <ESP8266WiFi.h>
+#include "tasks_utils.h"
+#include "config.h"
+#include "ConfigJournal.h"
+#include "Variables.h"
 
-SerialCommandTask::SerialCommandTask() {}
+SerialCommandTask::SerialCommandTask():
+    poll(this, SERIAL_POLL_MIN, SERIAL_POLL_MAX)
+{
+}
 
 void SerialCommandTask::run()
 {
+    bool activity = Serial.available();
+
     while (Serial.available())
     {
         auto c = Serial.read();
@@ -54,16 +63,35 @@ void SerialCommandTask::run()
             }
 
             //write
-            DataStore::value(variableName) = param;
+            DataStore::set(variableName, param);
             continue;
         }
 
         if (cmd == "variables")
         {
-            for (const auto& k: DataStore::availableKeys())
-            {
-                logPrintfX(F("SCT"), F("%s = '%s'"), k.c_str(), DataStore::value(k).c_str());
-            }
+            DataStore::forEach(String(), [](const String& k, const String& v) {
+                logPrintfX(F("SCT"), F("%s = '%s'"), k.c_str(), v.c_str());
+            });
+            //and the computed ones
+            Variables::forEach([](const String& k, Variables::Type) {
+                logPrintfX(F("SCT"), F("%s = '%s'"), k.c_str(), dataSource(k).c_str());
+            });
+            continue;
+        }
+
+        //set=<key>=<value> - stored in the config, unlike $<key>=<value>
+        if (cmd == "set")
+        {
+            String line = param;
+            auto p = splitLine(line);
+            if (!ConfigJournal::set(p.first, p.second))
+                logPrintfX(F("SCT"), F("Invalid config change: %s"), c_param);
+            continue;
+        }
+
+        if (cmd == "task")
+        {
+            controlTask(param);
             continue;
         }
 
@@ -76,6 +104,6 @@ void SerialCommandTask::run()
         logPrintfX(F("SCT"), F("Unknown commmand!"));
         
     }
-    sleep(0.1_s);
+    sleepFor(this, poll.next(activity));
 }
 
@@ -10,6 +10,7 @@
 
 #include <tasks.hpp>
 #include <Arduino.h>
+#include "AdaptivePoll.h"
 
 class SerialCommandTask: public Tasks::Task
 {
@@ -19,6 +20,7 @@ class SerialCommandTask: public Tasks::Task
 		virtual ~SerialCommandTask() = default;
 	private:
         String cumulatedInput;
+        AdaptivePoll poll;
 };
 
 #endif /* SERIALCOMMAND_H */
@@ -0,0 +1,217 @@
+/*
+ * StallWatchdog.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include "StallWatchdog.h"
+#include "TraceRecorder.h"
+#include "config.h"
+#include "utils.h"
+#include "ConfigSchema.h"
+#include "web_utils.h"
+
+#include <esp8266_peri.h>
+
+volatile uint32_t StallWatchdog::ticksSinceFeed = 0;
+volatile uint16_t StallWatchdog::currentTask = StallWatchdog::NO_TASK;
+
+const static uint32_t STALL_MAGIC = 0x314c5453;		//"STL1"
+
+struct StallRecord
+{
+	uint32_t uptime;			//s, when the stall started
+	uint32_t duration;			//ms, updated while it lasts
+	char task[12];
+	char activity[16];
+	uint32_t stack[STALL_STACK_SAMPLE];
+};
+
+//layout in the RTC user memory: magic, number of records written, the ring of records
+const static uint8_t RECORD_WORDS = sizeof(StallRecord) / 4;
+static_assert(sizeof(StallRecord) % 4 == 0, "StallRecord has to be made of whole words");
+static_assert(STALL_RTC_OFFSET + 2 + STALL_RECORDS * RECORD_WORDS <= 128, "stall records don't fit in the RTC user memory");
+
+static volatile uint32_t* const rtcHeader = RTC_USER_MEM + STALL_RTC_OFFSET;
+static volatile uint32_t* const rtcRecords = rtcHeader + 2;
+
+static uint32_t thresholdTicks = 0;
+static volatile uint32_t totalTicks = 0;
+
+//everything below runs in the interrupt - IRAM only, no library calls
+
+static void IRAM_ATTR copyName(char* to, size_t size, const char* from)
+{
+	size_t i = 0;
+	for (; i < size - 1 && from[i]; ++i)
+		to[i] = from[i];
+	for (; i < size; ++i)
+		to[i] = 0;
+}
+
+static bool IRAM_ATTR isCodeAddress(uint32_t v)
+{
+	return (v >= 0x40200000 && v < 0x40300000) ||		//flash
+		   (v >= 0x40100000 && v < 0x40108000);			//IRAM
+}
+
+static void IRAM_ATTR recordStall()
+{
+	StallRecord r;
+	r.uptime = totalTicks * STALL_TICK_MS / 1000;
+	r.duration = StallWatchdog::ticksSinceFeed * STALL_TICK_MS;
+
+	uint16_t task = StallWatchdog::currentTask;
+	copyName(r.task, sizeof(r.task), task == StallWatchdog::NO_TASK ? "-": Trace::nameOf(task));
+
+	int activity = Trace::activeId();
+	copyName(r.activity, sizeof(r.activity), activity == -1 ? "-": Trace::nameOf(activity));
+
+	//the interrupt runs on the stack of the stuck code, so its return addresses are right above
+	uint32_t marker = 0;
+	volatile uint32_t* sp = &marker;
+	uint8_t found = 0;
+	for (uint16_t i = 0; i < 512 && found < STALL_STACK_SAMPLE && (uintptr_t)(sp + i) < 0x40000000; ++i)
+	{
+		if (isCodeAddress(sp[i]))
+			r.stack[found++] = sp[i];
+	}
+	for (; found < STALL_STACK_SAMPLE; ++found)
+		r.stack[found] = 0;
+
+	//the RTC memory takes only 32-bit accesses
+	uint32_t count = rtcHeader[1];
+	volatile uint32_t* to = rtcRecords + (count % STALL_RECORDS) * RECORD_WORDS;
+	const uint32_t* from = (const uint32_t*)&r;
+	for (uint8_t i = 0; i < RECORD_WORDS; ++i)
+		to[i] = from[i];
+	rtcHeader[1] = count + 1;
+}
+
+static void IRAM_ATTR stallTick()
+{
+	totalTicks++;
+	uint32_t ticks = ++StallWatchdog::ticksSinceFeed;
+
+	if (thresholdTicks == 0 || ticks < thresholdTicks)
+		return;
+
+	if (ticks == thresholdTicks)
+	{
+		recordStall();
+		return;
+	}
+
+	//still stuck - the duration of the latest record grows
+	uint32_t latest = (rtcHeader[1] - 1) % STALL_RECORDS;
+	rtcRecords[latest * RECORD_WORDS + 1] = ticks * STALL_TICK_MS;
+}
+
+static StallRecord readRecord(uint8_t slot)
+{
+	StallRecord r;
+	uint32_t* to = (uint32_t*)&r;
+	for (uint8_t i = 0; i < RECORD_WORDS; ++i)
+		to[i] = rtcRecords[slot * RECORD_WORDS + i];
+
+	r.task[sizeof(r.task) - 1] = 0;
+	r.activity[sizeof(r.activity) - 1] = 0;
+	return r;
+}
+
+static void clearRecords()
+{
+	rtcHeader[1] = 0;
+	rtcHeader[0] = STALL_MAGIC;
+}
+
+static const char stallsPageHeader[] PROGMEM = R"_(
+<table>
+<tr><th>Last reset</th><td colspan="4">$reset$</td></tr>
+<tr><th>Up time [s]</th><th>Stalled [ms]</th><th>Task</th><th>Activity</th><th>Stack</th></tr>
+)_";
+
+static const char stallsPageRow[] PROGMEM = R"_(
+<tr><td>$uptime$</td><td>$duration$</td><td>$task$</td><td>$activity$</td><td>$stack$</td></tr>
+)_";
+
+static const char stallsPageFooter[] PROGMEM = R"_(
+</table>
+<a href="stalls?clear=1">Clear</a>
+</body>
+</html>
+)_";
+
+FlashStream stallsPageHeaderFS(stallsPageHeader);
+FlashStream stallsPageRowFS(stallsPageRow);
+FlashStream stallsPageFooterFS(stallsPageFooter);
+
+static void handleStallsPage(ESP8266WebServer& webServer)
+{
+	if (!handleAuth(webServer))
+		return;
+
+	if (webServer.hasArg(F("clear")))
+		clearRecords();
+
+	StringStream ss(2048);
+	macroStringReplace(pageHeaderFS, constString(F("Stalls")), ss);
+	macroStringReplace(stallsPageHeaderFS, constString(ESP.getResetReason()), ss);
+
+	//the newest first
+	uint32_t count = rtcHeader[1];
+	for (uint32_t i = 0; i < std::min<uint32_t>(count, STALL_RECORDS); ++i)
+	{
+		StallRecord r = readRecord((count - 1 - i) % STALL_RECORDS);
+
+		String stack;
+		char buffer[12];
+		for (auto a: r.stack)
+		{
+			if (!a)
+				break;
+			snprintf(buffer, sizeof(buffer), "%08x ", a);
+			stack += buffer;
+		}
+
+		std::map<String, String> m =
+		{
+			{F("uptime"), String(r.uptime)},
+			{F("duration"), String(r.duration)},
+			{F("task"), r.task},
+			{F("activity"), r.activity},
+			{F("stack"), stack},
+		};
+		macroStringReplace(stallsPageRowFS, mapLookup(m), ss);
+	}
+
+	macroStringReplace(stallsPageFooterFS, constString(String()), ss);
+	webServer.send(200, textHtml, ss.buffer);
+}
+
+void StallWatchdog::init()
+{
+	//garbage after a power-up
+	if (rtcHeader[0] != STALL_MAGIC)
+		clearRecords();
+
+	uint32_t count = rtcHeader[1];
+	if (count)
+	{
+		StallRecord r = readRecord((count - 1) % STALL_RECORDS);
+		logPrintfX(F("SWD"), F("%d stalls recorded, the last one in %s/%s (%d ms)"), count, r.task, r.activity, r.duration);
+	}
+
+	registerPage(F("stalls"), F("Stalls"), handleStallsPage);
+
+	uint32_t threshold = Config::getInt(Config::STALL_THRESHOLD);
+	thresholdTicks = threshold / STALL_TICK_MS;
+	if (thresholdTicks == 0)
+		return;
+
+	//timer1 counts at 80 MHz / 256
+	timer1_attachInterrupt(stallTick);
+	timer1_enable(TIM_DIV256, TIM_EDGE, TIM_LOOP);
+	timer1_write(STALL_TICK_MS * (80000000 / 256 / 1000));
+}
@@ -0,0 +1,32 @@
+/*
+ * StallWatchdog.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef STALLWATCHDOG_H_
+#define STALLWATCHDOG_H_
+
+#include <Arduino.h>
+
+// Notices from the timer1 interrupt that loop() hasn't come back for too long
+// and writes down who was running: the task, the innermost trace scope (web
+// handler, fetch phase...) and code addresses found on the stack. The records
+// are kept in the RTC memory, so they survive the WDT reset that usually follows.
+
+namespace StallWatchdog
+{
+	const static uint16_t NO_TASK = 0xFFFF;
+
+	extern volatile uint32_t ticksSinceFeed;
+	//trace id of the running task, NO_TASK between the tasks
+	extern volatile uint16_t currentTask;
+
+	//called at the start of every loop()
+	inline void feed() {ticksSinceFeed = 0;}
+
+	void init();
+}
+
+#endif /* STALLWATCHDOG_H_ */
@@ -0,0 +1,535 @@
+/*
+ * TimeSeries.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include "TimeSeries.h"
+#include "LittleFS.h"
+#include "utils.h"
+#include "time_utils.h"
+#include "pyfont.h"
+#include "Variables.h"
+#include "web_utils.h"
+#include "WebServerTask.h"
+#include <algorithm>
+#include <map>
+
+//"TSR1"
+const static uint32_t FILE_MAGIC = 0x31525354;
+
+struct FileHeader
+{
+	uint32_t magic;
+	uint32_t time;			//time(nullptr) of the save, 0 if it wasn't known
+	uint8_t levels;
+	uint8_t scale;
+};
+
+//followed by the deltas of the ring, all the capacity
+struct RingHeader
+{
+	uint32_t period;
+	uint16_t capacity;
+	uint16_t head;
+	uint16_t size;
+	int16_t first;
+	int16_t last;
+	uint8_t valued;
+};
+
+//before SNTP the clock starts at 1970
+static bool timeKnown(time_t t)
+{
+	return t > 1000000000;
+}
+
+static std::vector<TimeSeries*> series;
+
+TimeSeries::TimeSeries(const String& name, std::initializer_list<Level> levels, uint8_t scale, bool persistent):
+	name(name),
+	scale(scale),
+	persistent(persistent)
+{
+	for (const auto& l: levels)
+	{
+		Ring r = {l.period * 1000, l.samples, 0, 0, 0, 0, false, (uint32_t)millis(), 0, 0, 0,
+				std::unique_ptr<int8_t[]>(new int8_t[l.samples])};
+		rings.push_back(std::move(r));
+	}
+
+	if (persistent)
+		load();
+
+	series.push_back(this);
+}
+
+TimeSeries::~TimeSeries()
+{
+	series.erase(std::remove(series.begin(), series.end(), this), series.end());
+}
+
+void TimeSeries::add(float value)
+{
+	time_t now = time(nullptr);
+	if (resumeTime && timeKnown(now))
+	{
+		//the samples missed while the clock was off
+		if (now > resumeTime)
+		{
+			for (auto& r: rings)
+			{
+				uint32_t gaps = std::min<uint32_t>((now - resumeTime) / (r.period / 1000), r.capacity);
+				while (gaps--)
+					store(r, false, 0);
+			}
+		}
+		resumeTime = 0;
+	}
+
+	//the periods that ended since the last measurement, at most a whole ring of gaps
+	Ring& r = rings[0];
+	uint32_t elapsed = millis() - r.closed;
+	if (elapsed / r.period > r.capacity)
+	{
+		r.closed += (elapsed / r.period - r.capacity) * r.period;
+		r.sum = 0;
+		r.count = 0;
+	}
+
+	while (millis() - r.closed >= r.period)
+	{
+		r.closed += r.period;
+		close(0);
+	}
+
+	//once after a catch-up of many periods, not at every one of them
+	if (saveDue)
+	{
+		saveDue = false;
+		save();
+	}
+
+	if (isnan(value))
+		return;
+
+	r.sum += lround(value * scale);
+	r.count++;
+}
+
+void TimeSeries::store(Ring& r, bool present, int16_t value)
+{
+	int8_t delta = GAP;
+	if (present && !r.valued)
+	{
+		r.first = r.last = value;
+		r.valued = true;
+		delta = 0;
+	}
+	else if (present)
+	{
+		delta = std::max(std::min(value - r.last, (int)INT8_MAX), -(int)INT8_MAX);
+		r.last += delta;
+	}
+
+	//the oldest sample goes, its value becomes the base of the others
+	if (r.size == r.capacity)
+	{
+		if (r.deltas[r.head] != GAP)
+			r.first += r.deltas[r.head];
+		r.head = (r.head + 1) % r.capacity;
+		r.size--;
+	}
+
+	r.deltas[(r.head + r.size) % r.capacity] = delta;
+	r.size++;
+}
+
+void TimeSeries::close(uint8_t level)
+{
+	Ring& r = rings[level];
+
+	bool present = r.count;
+	int16_t average = present ? lround((float)r.sum / r.count): 0;
+	r.sum = 0;
+	r.count = 0;
+	r.inputs = 0;
+
+	store(r, present, average);
+
+	if (level + 1u == rings.size())
+	{
+		saveDue = persistent;
+		return;
+	}
+
+	Ring& up = rings[level + 1];
+	if (present)
+	{
+		up.sum += average;
+		up.count++;
+	}
+
+	if (++up.inputs * r.period >= up.period)
+	{
+		up.closed = r.closed;
+		close(level + 1);
+	}
+}
+
+uint32_t TimeSeries::getPeriod(uint8_t level) const
+{
+	return rings[level].period / 1000;
+}
+
+uint16_t TimeSeries::getSize(uint8_t level) const
+{
+	return rings[level].size;
+}
+
+void TimeSeries::forEach(uint8_t level, SampleCallback callback) const
+{
+	const Ring& r = rings[level];
+	uint32_t age = (millis() - r.closed) / 1000;
+	int16_t value = r.first;
+
+	for (uint16_t i = 0; i < r.size; ++i)
+	{
+		int8_t delta = r.deltas[(r.head + i) % r.capacity];
+		uint32_t sampleAge = age + (r.size - 1 - i) * (r.period / 1000);
+
+		if (delta == GAP)
+		{
+			callback(sampleAge, NAN);
+			continue;
+		}
+
+		value += delta;
+		callback(sampleAge, (float)value / scale);
+	}
+}
+
+TimeSeries::Stats TimeSeries::getStats(uint8_t level, uint16_t count) const
+{
+	Stats s = {0, 0, 0, 0};
+	uint16_t skip = count && count < getSize(level) ? getSize(level) - count: 0;
+	float sum = 0;
+
+	forEach(level, [&](uint32_t, float value)
+	{
+		if (skip)
+		{
+			skip--;
+			return;
+		}
+
+		if (isnan(value))
+			return;
+
+		s.min = s.count ? std::min(s.min, value): value;
+		s.max = s.count ? std::max(s.max, value): value;
+		sum += value;
+		s.count++;
+	});
+
+	if (s.count)
+		s.avg = sum / s.count;
+
+	return s;
+}
+
+String TimeSeries::sparkline(uint8_t level, uint16_t count) const
+{
+	Stats s = getStats(level, count);
+	uint16_t skip = count < getSize(level) ? getSize(level) - count: 0;
+
+	String result;
+	result.reserve(std::min(count, getSize(level)));
+
+	forEach(level, [&](uint32_t, float value)
+	{
+		if (skip)
+		{
+			skip--;
+			return;
+		}
+
+		if (isnan(value))
+		{
+			result += SPARK_BAR;
+			return;
+		}
+
+		//1-8 rows, a flat line in the middle
+		uint8_t height = s.max > s.min ? 1 + lround((value - s.min) * 7 / (s.max - s.min)): 4;
+		result += (char)(SPARK_BAR + height);
+	});
+
+	return result;
+}
+
+String TimeSeries::fileName() const
+{
+	return String(F("/ts_")) + name + F(".bin");
+}
+
+//written to a temporary file and renamed, a reset during the save keeps the old history
+bool TimeSeries::save() const
+{
+	time_t now = time(nullptr);
+	FileHeader h = {FILE_MAGIC, timeKnown(now) ? (uint32_t)now: 0, (uint8_t)rings.size(), scale};
+	String temp = String(F("/ts_")) + name + F(".tmp");
+
+	LittleFS.begin();
+	auto file = LittleFS.open(temp, "w");
+	bool ok = static_cast<bool>(file);
+	if (ok)
+	{
+		ok = file.write((const uint8_t*)&h, sizeof(h)) == sizeof(h);
+		for (const auto& r: rings)
+		{
+			RingHeader rh = {r.period, r.capacity, r.head, r.size, r.first, r.last, r.valued};
+			ok = ok && file.write((const uint8_t*)&rh, sizeof(rh)) == sizeof(rh);
+			ok = ok && file.write((const uint8_t*)r.deltas.get(), r.capacity) == r.capacity;
+		}
+		file.close();
+
+		ok = ok && LittleFS.rename(temp.c_str(), fileName().c_str());
+		if (!ok)
+			LittleFS.remove(temp.c_str());
+	}
+	LittleFS.end();
+
+	if (!ok)
+		logPrintfX(F("TS"), F("History of %s not saved!"), name.c_str());
+	return ok;
+}
+
+bool TimeSeries::load()
+{
+	LittleFS.begin();
+	auto file = LittleFS.open(fileName(), "r");
+	if (!file)
+	{
+		LittleFS.end();
+		return false;
+	}
+
+	//the levels have to be the same as the ones saved
+	FileHeader h;
+	bool ok = file.read((uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+			h.magic == FILE_MAGIC && h.levels == rings.size() && h.scale == scale;
+
+	for (size_t i = 0; ok && i < rings.size(); ++i)
+	{
+		Ring& r = rings[i];
+		RingHeader rh;
+		ok = file.read((uint8_t*)&rh, sizeof(rh)) == sizeof(rh) &&
+				rh.period == r.period && rh.capacity == r.capacity && rh.head < r.capacity && rh.size <= r.capacity &&
+				file.read((uint8_t*)r.deltas.get(), r.capacity) == r.capacity;
+
+		if (ok)
+		{
+			r.head = rh.head;
+			r.size = rh.size;
+			r.first = rh.first;
+			r.last = rh.last;
+			r.valued = rh.valued;
+		}
+		else
+		{
+			//an incomplete level is dropped with the ones above it
+			for (size_t j = i; j < rings.size(); ++j)
+			{
+				rings[j].size = 0;
+				rings[j].valued = false;
+			}
+		}
+	}
+
+	file.close();
+	LittleFS.end();
+
+	resumeTime = ok ? h.time: 0;
+	logPrintfX(F("TS"), F("History of %s %s"), name.c_str(), ok ? "loaded": "not loaded");
+	return ok;
+}
+
+const std::vector<TimeSeries*>& TimeSeries::getAll()
+{
+	return series;
+}
+
+TimeSeries* TimeSeries::find(const String& name)
+{
+	auto it = std::find_if(series.begin(), series.end(), [&name](TimeSeries* s) {return s->getName() == name;});
+	return it == series.end() ? nullptr: *it;
+}
+
+static const char historyPage[] PROGMEM = R"_(
+<table>
+<tr><th>Series</th><th>Period</th><th>Samples</th><th>Min</th><th>Avg</th><th>Max</th><th>Export</th></tr>
+)_";
+
+static const char historyPageRow[] PROGMEM = R"_(
+<tr><td class="l">$name$</td><td>$period$</td><td>$samples$</td><td>$min$</td><td>$avg$</td><td>$max$</td>
+<td><a href="history.csv?name=$name$&level=$level$">CSV</a> | <a href="history.json?name=$name$&level=$level$">JSON</a></td></tr>
+)_";
+
+static const char historyPageFooter[] PROGMEM = R"_(
+</table></body>
+</html>
+)_";
+
+FlashStream historyPageFS(historyPage);
+FlashStream historyPageRowFS(historyPageRow);
+FlashStream historyPageFooterFS(historyPageFooter);
+
+static void handleHistoryPage(ESP8266WebServer& webServer)
+{
+	StringStream ss(2048);
+	macroStringReplace(pageHeaderFS, constString(F("History")), ss);
+	macroStringReplace(historyPageFS, constString(String()), ss);
+
+	for (auto s: series)
+	{
+		for (uint8_t level = 0; level < s->getLevels(); ++level)
+		{
+			auto stats = s->getStats(level);
+			std::map<String, String> m =
+			{
+				{F("name"), s->getName()},
+				{F("level"), String(level)},
+				{F("period"), formatDeltaTime(s->getPeriod(level), DeltaTimePrecision::SECONDS)},
+				{F("samples"), String(s->getSize(level))},
+				{F("min"), stats.count ? String(stats.min, 1): String('-')},
+				{F("avg"), stats.count ? String(stats.avg, 1): String('-')},
+				{F("max"), stats.count ? String(stats.max, 1): String('-')},
+			};
+			macroStringReplace(historyPageRowFS, mapLookup(m), ss);
+		}
+	}
+
+	macroStringReplace(historyPageFooterFS, constString(String()), ss);
+	webServer.send(200, textHtml, ss.buffer);
+}
+
+//the series and the level from the arguments, nullptr if there is no such one
+static TimeSeries* findSeries(ESP8266WebServer& webServer, uint8_t& level)
+{
+	auto s = TimeSeries::find(webServer.arg(F("name")));
+	level = webServer.arg(F("level")).toInt();
+
+	if (!s || level >= s->getLevels())
+	{
+		webServer.send(404, textPlain, F("No such series!"));
+		return nullptr;
+	}
+
+	return s;
+}
+
+// "time,value" - the Unix time of the end of the period (the age in seconds if the clock
+// is not set yet), the value is empty for a gap
+static void handleHistoryCsv(ESP8266WebServer& webServer)
+{
+	uint8_t level;
+	auto s = findSeries(webServer, level);
+	if (!s)
+		return;
+
+	time_t now = time(nullptr);
+	bool absolute = timeKnown(now);
+
+	webServer.chunkedResponseModeStart(200, "text/csv");
+	String chunk = absolute ? F("time,value\n"): F("age,value\n");
+
+	s->forEach(level, [&](uint32_t age, float value)
+	{
+		chunk += absolute ? String((uint32_t)(now - age)): String(age);
+		chunk += ',';
+		if (!isnan(value))
+			chunk += String(value, 1);
+		chunk += '\n';
+
+		if (chunk.length() > 900)
+		{
+			webServer.sendContent(chunk);
+			chunk = String();
+		}
+	});
+
+	webServer.sendContent(chunk);
+	webServer.chunkedResponseFinalize();
+}
+
+// {"name":..., "period":s, "age":s of the newest sample, "values":[the oldest first, null for the gaps]}
+static void handleHistoryJson(ESP8266WebServer& webServer)
+{
+	uint8_t level;
+	auto s = findSeries(webServer, level);
+	if (!s)
+		return;
+
+	uint32_t newest = 0;
+	s->forEach(level, [&newest](uint32_t age, float) {newest = age;});
+
+	webServer.chunkedResponseModeStart(200, "application/json");
+	String chunk = F("{\"name\":\"");
+	chunk += s->getName();
+	chunk += F("\",\"period\":");
+	chunk += s->getPeriod(level);
+	chunk += F(",\"age\":");
+	chunk += newest;
+	chunk += F(",\"values\":[");
+
+	bool firstValue = true;
+	s->forEach(level, [&](uint32_t, float value)
+	{
+		if (!firstValue)
+			chunk += ',';
+		firstValue = false;
+		chunk += isnan(value) ? String(F("null")): String(value, 1);
+
+		if (chunk.length() > 900)
+		{
+			webServer.sendContent(chunk);
+			chunk = String();
+		}
+	});
+
+	chunk += F("]}\n");
+	webServer.sendContent(chunk);
+	webServer.chunkedResponseFinalize();
+}
+
+void TimeSeries::init()
+{
+	registerPage(F("history"), F("History"), handleHistoryPage);
+	registerPage(F("history.csv"), String(), handleHistoryCsv);
+	registerPage(F("history.json"), String(), handleHistoryJson);
+
+	//"history.lst.avg" - min, avg or max of the finest level
+	Variables::addPrefix(F("history."), [](const String& name)
+	{
+		int dot = name.lastIndexOf('.');
+		auto s = dot == -1 ? nullptr: TimeSeries::find(name.substring(0, dot));
+		if (!s)
+			return String();
+
+		auto stats = s->getStats(0);
+		if (!stats.count)
+			return String();
+
+		String stat = name.substring(dot + 1);
+
+		if (stat == F("min"))
+			return String(stats.min, 1);
+		if (stat == F("avg"))
+			return String(stats.avg, 1);
+		if (stat == F("max"))
+			return String(stats.max, 1);
+		return String();
+	});
+}
@@ -0,0 +1,109 @@
+/*
+ * TimeSeries.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef TIMESERIES_H_
+#define TIMESERIES_H_
+
+#include "Arduino.h"
+#include <vector>
+#include <memory>
+#include <functional>
+#include <initializer_list>
+
+//The history of a measured value in a fixed amount of RAM. Every level is a ring
+//of averages over its period (e.g. 1 min, 15 min, 1 h), filled with the averages
+//of the level below it; the periods have to be multiples of each other. A sample
+//is one byte - the difference from the previous sample in the fixed point units
+//(1/scale), the ring keeps the value its deltas start from. A larger jump is
+//spread over the next samples. 48 h of 1-minute samples take 2880 bytes.
+class TimeSeries
+{
+	public:
+		struct Level
+		{
+			uint32_t period;		//s
+			uint16_t samples;
+		};
+
+		struct Stats
+		{
+			float min;
+			float max;
+			float avg;
+			uint16_t count;			//samples with a value, the rest are 0 if none
+		};
+
+		//the levels from the finest one; a persistent series is kept in /ts_<name>.bin
+		TimeSeries(const String& name, std::initializer_list<Level> levels, uint8_t scale = 10, bool persistent = false);
+		~TimeSeries();
+
+		//called whenever the value is measured, NAN if it couldn't be
+		void add(float value);
+
+		const String& getName() const {return name;}
+		uint8_t getLevels() const {return rings.size();}
+		uint32_t getPeriod(uint8_t level) const;
+		//the stored samples, the gaps included
+		uint16_t getSize(uint8_t level) const;
+
+		//from the oldest sample, age in seconds, NAN for the gaps
+		using SampleCallback = std::function<void(uint32_t age, float value)>;
+		void forEach(uint8_t level, SampleCallback callback) const;
+
+		//of the last count samples, 0 - all of them
+		Stats getStats(uint8_t level, uint16_t count = 0) const;
+
+		//the last count samples as SPARK_BAR characters scaled to their range, a gap is an empty column
+		String sparkline(uint8_t level, uint16_t count) const;
+
+		bool save() const;
+		bool load();
+
+		static const std::vector<TimeSeries*>& getAll();
+		static TimeSeries* find(const String& name);
+
+		//registers the history pages
+		static void init();
+
+	private:
+		//the marker of a sample without a value
+		const static int8_t GAP = INT8_MIN;
+
+		struct Ring
+		{
+			uint32_t period;		//ms
+			uint16_t capacity;
+			uint16_t head;			//the oldest sample
+			uint16_t size;
+			int16_t first;			//the value the deltas of the stored samples start from
+			int16_t last;			//and of the newest one
+			bool valued;			//first and last were set
+			uint32_t closed;		//millis() of the newest sample
+
+			//the averaged samples of the level below (or the measurements)
+			int32_t sum;
+			uint16_t count;
+			uint16_t inputs;
+
+			std::unique_ptr<int8_t[]> deltas;
+		};
+
+		void store(Ring& r, bool present, int16_t value);
+		void close(uint8_t level);
+		String fileName() const;
+
+		String name;
+		uint8_t scale;
+		bool persistent;
+		//time(nullptr) of the saved samples, the gap till now is added once the time is known
+		time_t resumeTime = 0;
+		//the coarsest level closed, saved at the end of add()
+		bool saveDue = false;
+		std::vector<Ring> rings;
+};
+
+#endif /* TIMESERIES_H_ */
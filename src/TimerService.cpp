@@ -0,0 +1,124 @@
+/*
+ * TimerService.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include <algorithm>
+
+#include "TimerService.h"
+#include "tasks_utils.h"
+#include "utils.h"
+
+TimerService& TimerService::getInstance()
+{
+	static TimerService timerService;
+	return timerService;
+}
+
+TimerService::TimerService()
+{
+	//nothing to do till the first timer is added
+	suspend();
+}
+
+int TimerService::add(uint32_t ms, uint32_t period, TimerCallback callback, void* arg)
+{
+	for (uint8_t i = 0; i < TIMER_POOL_SIZE; ++i)
+	{
+		auto& s = slots[i];
+		if (s.callback)
+			continue;
+
+		s = {callback, arg, micros64() + ms * 1000ULL, period};
+		used++;
+		highWater = std::max(highWater, used);
+
+		//let run() recalculate its sleep
+		wakeTask(this);
+		return i;
+	}
+
+	logPrintfX(F("TMR"), F("Timer pool is full (%d slots)!"), TIMER_POOL_SIZE);
+	return -1;
+}
+
+int TimerService::runAfter(uint32_t ms, TimerCallback callback, void* arg)
+{
+	return add(ms, 0, callback, arg);
+}
+
+int TimerService::runEvery(uint32_t ms, TimerCallback callback, void* arg)
+{
+	if (ms == 0)
+		return -1;
+
+	return add(ms, ms, callback, arg);
+}
+
+void TimerService::cancel(int id)
+{
+	if (id < 0 || id >= TIMER_POOL_SIZE || !slots[id].callback)
+		return;
+
+	slots[id].callback = nullptr;
+	used--;
+}
+
+void TimerService::run()
+{
+	uint64_t now = micros64();
+
+	for (auto& s: slots)
+	{
+		if (!s.callback || s.due > now)
+			continue;
+
+		//copied - the callback may cancel its own slot or reuse it
+		Slot fired = s;
+		if (s.period)
+		{
+			s.due += s.period * 1000ULL;
+			if (s.due <= now)
+				s.due = now + s.period * 1000ULL;
+		}
+		else
+		{
+			s.callback = nullptr;
+			used--;
+		}
+
+		fired.callback(fired.arg);
+	}
+
+	uint64_t next = UINT64_MAX;
+	for (const auto& s: slots)
+	{
+		if (s.callback)
+			next = std::min(next, s.due);
+	}
+
+	if (next == UINT64_MAX)
+	{
+		suspend();
+		return;
+	}
+
+	now = micros64();
+	sleepFor(this, next > now ? (next - now + 999) / 1000: 0);
+}
+
+String TimerService::getStatistic(const String& name) const
+{
+	if (name == F("used"))
+		return String(used);
+
+	if (name == F("max"))
+		return String(highWater);
+
+	if (name == F("size"))
+		return String(TIMER_POOL_SIZE);
+
+	return String();
+}
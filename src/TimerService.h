@@ -0,0 +1,56 @@
+/*
+ * TimerService.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef TIMERSERVICE_H_
+#define TIMERSERVICE_H_
+
+#include <tasks.hpp>
+#include "Arduino.h"
+#include "config.h"
+
+//plain function + argument - nothing is allocated, captureless lambdas convert to it
+using TimerCallback = void (*)(void* arg);
+
+//Deferred and repeated actions from a fixed pool of slots, run by one task.
+//A slot is free again as soon as a one-shot timer has fired or is cancelled.
+class TimerService: public Tasks::Task
+{
+	public:
+		static TimerService& getInstance();
+
+		//return the id of the slot, -1 if the pool is full
+		int runAfter(uint32_t ms, TimerCallback callback, void* arg = nullptr);
+		int runEvery(uint32_t ms, TimerCallback callback, void* arg = nullptr);
+		void cancel(int id);
+
+		virtual void run();
+
+		uint8_t getUsed() const {return used;}
+		uint8_t getHighWater() const {return highWater;}
+
+		//"used", "max" or "size", empty if unknown
+		String getStatistic(const String& name) const;
+
+	private:
+		TimerService();
+
+		struct Slot
+		{
+			TimerCallback callback;
+			void* arg;
+			uint64_t due;			//micros64()
+			uint32_t period;		//ms, 0 - one-shot
+		};
+
+		int add(uint32_t ms, uint32_t period, TimerCallback callback, void* arg);
+
+		Slot slots[TIMER_POOL_SIZE] = {};
+		uint8_t used = 0;
+		uint8_t highWater = 0;
+};
+
+#endif /* TIMERSERVICE_H_ */
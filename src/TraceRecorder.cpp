@@ -0,0 +1,219 @@
+/*
+ * TraceRecorder.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include "TraceRecorder.h"
+#include <algorithm>
+#include "config.h"
+#include "utils.h"
+#include "ConfigSchema.h"
+#include "web_utils.h"
+
+static_assert((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0, "TRACE_BUFFER_SIZE has to be a power of two");
+
+const static uint32_t TRACE_MAGIC = 0x31435254;		//"TRC1"
+
+bool Trace::enabled = false;
+volatile uint16_t Trace::activeIds[MAX_DEPTH];
+volatile uint8_t Trace::activeDepth = 0;
+
+static Trace::Event events[TRACE_BUFFER_SIZE];
+static uint16_t head = 0;
+static uint16_t count = 0;
+
+//plain array of never freed copies - the stall watchdog reads it from an interrupt
+static const char* names[TRACE_MAX_NAMES];
+static uint16_t nameCount = 0;
+
+uint16_t Trace::registerName(const String& name)
+{
+	for (uint16_t i = 0; i < nameCount; ++i)
+	{
+		if (name == names[i])
+			return i;
+	}
+
+	//the last one collects all the names that don't fit
+	if (nameCount == TRACE_MAX_NAMES - 1)
+		names[nameCount++] = "other";
+
+	if (nameCount == TRACE_MAX_NAMES)
+		return TRACE_MAX_NAMES - 1;
+
+	names[nameCount] = strdup(name.c_str());
+	return nameCount++;
+}
+
+const char* IRAM_ATTR Trace::nameOf(uint16_t id)
+{
+	return id < nameCount ? names[id]: "?";
+}
+
+int IRAM_ATTR Trace::activeId()
+{
+	uint8_t depth = activeDepth;
+	if (depth == 0)
+		return -1;
+
+	return activeIds[std::min(depth, MAX_DEPTH) - 1];
+}
+
+void Trace::recordEvent(uint16_t id, Type type)
+{
+	events[head] = Event{ESP.getCycleCount(), id, type, 0};
+	head = (head + 1) & (TRACE_BUFFER_SIZE - 1);
+	if (count < TRACE_BUFFER_SIZE)
+		count++;
+}
+
+void Trace::clear()
+{
+	head = 0;
+	count = 0;
+}
+
+//i-th oldest event
+static const Trace::Event& eventAt(uint16_t i)
+{
+	return events[(head - count + i) & (TRACE_BUFFER_SIZE - 1)];
+}
+
+static void handleTraceJson(ESP8266WebServer& webServer)
+{
+	if (!handleAuth(webServer))
+		return;
+
+	//don't record the export itself
+	bool wasEnabled = Trace::enabled;
+	Trace::enabled = false;
+
+	webServer.chunkedResponseModeStart(200, "application/json");
+	webServer.sendContent(F("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"));
+
+	static const char* const phases[] = {"B", "E", "i"};
+	uint32_t mhz = ESP.getCpuFreqMHz();
+	uint32_t previous = count ? eventAt(0).cycles: 0;
+	uint64_t cycles = 0;
+
+	String chunk;
+	chunk.reserve(1024);
+	char buffer[128];
+
+	for (uint16_t i = 0; i < count; ++i)
+	{
+		const auto& e = eventAt(i);
+
+		//unwrap the 32-bit cycle counter
+		cycles += e.cycles - previous;
+		previous = e.cycles;
+
+		uint32_t us = cycles / mhz;
+		uint32_t ns = (cycles % mhz) * 1000 / mhz;
+		const char* name = Trace::nameOf(e.id);
+
+		snprintf(buffer, sizeof(buffer), "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%u.%03u,\"pid\":1,\"tid\":1}\n",
+				i ? ",": "", name, phases[(uint8_t)e.type], us, ns);
+		chunk += buffer;
+
+		if (chunk.length() > 900)
+		{
+			webServer.sendContent(chunk);
+			chunk = String();
+		}
+	}
+
+	chunk += F("]}\n");
+	webServer.sendContent(chunk);
+	webServer.chunkedResponseFinalize();
+
+	Trace::enabled = wasEnabled;
+}
+
+// Binary dump, see tools/trace2json.py:
+//   uint32_t magic, cpu MHz, event count, name count
+//   names as uint8_t length + characters
+//   events, the oldest first
+static void handleTraceBinary(ESP8266WebServer& webServer)
+{
+	if (!handleAuth(webServer))
+		return;
+
+	bool wasEnabled = Trace::enabled;
+	Trace::enabled = false;
+
+	webServer.chunkedResponseModeStart(200, "application/octet-stream");
+
+	uint32_t header[] = {TRACE_MAGIC, ESP.getCpuFreqMHz(), count, nameCount};
+	webServer.sendContent((const char*)header, sizeof(header));
+
+	for (uint16_t i = 0; i < nameCount; ++i)
+	{
+		uint8_t length = std::min<size_t>(strlen(names[i]), 255);
+		webServer.sendContent((const char*)&length, 1);
+		webServer.sendContent(names[i], length);
+	}
+
+	//the buffer may wrap, send it in at most two pieces
+	uint16_t first = (head - count) & (TRACE_BUFFER_SIZE - 1);
+	uint16_t firstPart = std::min<uint16_t>(count, TRACE_BUFFER_SIZE - first);
+	webServer.sendContent((const char*)&events[first], firstPart * sizeof(Trace::Event));
+	webServer.sendContent((const char*)&events[0], (count - firstPart) * sizeof(Trace::Event));
+
+	webServer.chunkedResponseFinalize();
+
+	Trace::enabled = wasEnabled;
+}
+
+static const char tracePage[] PROGMEM = R"_(
+<table>
+<tr><th>Trace recorder</th></tr>
+<tr><td class="l">Recording:</td><td>$enabled$</td></tr>
+<tr><td class="l">Events:</td><td>$events$</td></tr>
+<tr><td class="l">Names:</td><td>$names$</td></tr>
+</table>
+<a href="trace?enable=1">Start</a> | <a href="trace?enable=0">Stop</a> | <a href="trace?clear=1">Clear</a> |
+<a href="trace.json">Download (Chrome JSON)</a> | <a href="trace.bin">Download (binary)</a>
+</body>
+</html>
+)_";
+
+FlashStream tracePageFS(tracePage);
+
+static void handleTracePage(ESP8266WebServer& webServer)
+{
+	if (!handleAuth(webServer))
+		return;
+
+	if (webServer.hasArg(F("enable")))
+	{
+		Trace::enabled = webServer.arg(F("enable")).toInt();
+		logPrintfX(F("TR"), F("Recording %s"), Trace::enabled ? "started": "stopped");
+	}
+
+	if (webServer.hasArg(F("clear")))
+		Trace::clear();
+
+	std::map<String, String> m =
+	{
+		{F("enabled"), Trace::enabled ? F("yes"): F("no")},
+		{F("events"), String(count) + " / " + String(TRACE_BUFFER_SIZE)},
+		{F("names"), String(nameCount)},
+	};
+
+	StringStream ss(2048);
+	macroStringReplace(pageHeaderFS, constString(F("Trace")), ss);
+	macroStringReplace(tracePageFS, mapLookup(m), ss);
+	webServer.send(200, textHtml, ss.buffer);
+}
+
+void Trace::init()
+{
+	enabled = Config::getBool(Config::TRACE_ENABLED);
+
+	registerPage(F("trace"), F("Trace"), handleTracePage);
+	registerPage(F("trace.json"), String(), handleTraceJson);
+	registerPage(F("trace.bin"), String(), handleTraceBinary);
+}
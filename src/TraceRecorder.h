@@ -0,0 +1,83 @@
+/*
+ * TraceRecorder.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef TRACERECORDER_H_
+#define TRACERECORDER_H_
+
+#include <Arduino.h>
+
+// Ring buffer of timestamped begin/end events, exported as a binary dump
+// (tools/trace2json.py) or directly in the Chrome/Perfetto trace format.
+// Timestamps are raw CPU cycles, the exporter unwraps them.
+
+namespace Trace
+{
+	enum class Type: uint8_t
+	{
+		BEGIN,
+		END,
+		INSTANT
+	};
+
+	struct Event
+	{
+		uint32_t cycles;
+		uint16_t id;
+		Type	 type;
+		uint8_t	 reserved;
+	};
+
+	extern bool enabled;
+
+	//ids of the scopes the loop is in right now, kept even when not recording
+	const static uint8_t MAX_DEPTH = 4;
+	extern volatile uint16_t activeIds[MAX_DEPTH];
+	extern volatile uint8_t activeDepth;
+
+	//returns the id of the name, the same name gets the same id
+	uint16_t registerName(const String& name);
+	//safe to call from an interrupt
+	const char* nameOf(uint16_t id);
+	//the innermost active scope, -1 if none
+	int activeId();
+
+	void recordEvent(uint16_t id, Type type);
+
+	inline void record(uint16_t id, Type type)
+	{
+		if (enabled)
+			recordEvent(id, type);
+	}
+
+	inline void begin(uint16_t id)
+	{
+		if (activeDepth < MAX_DEPTH)
+			activeIds[activeDepth] = id;
+		activeDepth++;
+		record(id, Type::BEGIN);
+	}
+
+	inline void end(uint16_t id)
+	{
+		if (activeDepth)
+			activeDepth--;
+		record(id, Type::END);
+	}
+
+	struct Scope
+	{
+		Scope(uint16_t id): id(id) {begin(id);}
+		~Scope() {end(id);}
+
+		uint16_t id;
+	};
+
+	void clear();
+	void init();
+}
+
+#endif /* TRACERECORDER_H_ */
@@ -0,0 +1,180 @@
+/*
+ * Variables.cpp
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#include "Variables.h"
+#include <vector>
+#include <ctype.h>
+
+using namespace Variables;
+
+struct Variable
+{
+	String name;
+	uint32_t hash;
+	Type type;
+	uint8_t decimals;
+	const char* unit;
+
+	TextGetter text;
+	IntGetter integer;
+	FloatGetter real;
+};
+
+const static uint8_t NONE = UINT8_MAX;
+
+//the variables in the order of registration, the table maps the hashes to their
+//indices with linear probing, its load is kept under 3/4
+static std::vector<Variable> variables;
+static std::vector<uint8_t> table;
+static std::vector<std::pair<String, PrefixGetter>> prefixes;
+
+const static size_t INITIAL_TABLE_SIZE = 32;
+
+//FNV-1a of the lower case name
+static uint32_t hashName(const char* s)
+{
+	uint32_t h = 2166136261u;
+	while (uint8_t c = *s++)
+		h = (h ^ (uint8_t)tolower(c)) * 16777619u;
+	return h;
+}
+
+//the slot of the name or the empty one where it belongs
+static size_t findSlot(const char* name, uint32_t hash)
+{
+	size_t mask = table.size() - 1;
+	size_t slot = hash & mask;
+
+	while (table[slot] != NONE)
+	{
+		const auto& v = variables[table[slot]];
+		if (v.hash == hash && strcasecmp(v.name.c_str(), name) == 0)
+			break;
+		slot = (slot + 1) & mask;
+	}
+
+	return slot;
+}
+
+static void growTable()
+{
+	table.assign(table.empty() ? INITIAL_TABLE_SIZE: table.size() * 2, NONE);
+
+	size_t mask = table.size() - 1;
+	for (uint8_t i = 0; i < variables.size(); ++i)
+	{
+		size_t slot = variables[i].hash & mask;
+		while (table[slot] != NONE)
+			slot = (slot + 1) & mask;
+		table[slot] = i;
+	}
+}
+
+static void add(Variable&& v)
+{
+	v.hash = hashName(v.name.c_str());
+
+	if (!table.empty())
+	{
+		size_t slot = findSlot(v.name.c_str(), v.hash);
+		if (table[slot] != NONE)
+		{
+			variables[table[slot]] = std::move(v);
+			return;
+		}
+	}
+
+	//the indices are bytes
+	if (variables.size() + 1 == NONE)
+		return;
+
+	if ((variables.size() + 1) * 4 > table.size() * 3)
+		growTable();
+
+	size_t slot = findSlot(v.name.c_str(), v.hash);
+	table[slot] = variables.size();
+	variables.push_back(std::move(v));
+}
+
+void Variables::addText(const String& name, TextGetter getter)
+{
+	add(Variable{name, 0, Type::TEXT, 0, nullptr, getter, nullptr, nullptr});
+}
+
+void Variables::addInt(const String& name, IntGetter getter, const char* unit)
+{
+	add(Variable{name, 0, Type::INT, 0, unit, nullptr, getter, nullptr});
+}
+
+void Variables::addFloat(const String& name, FloatGetter getter, uint8_t decimals)
+{
+	add(Variable{name, 0, Type::FLOAT, decimals, nullptr, nullptr, nullptr, getter});
+}
+
+void Variables::addPrefix(const String& prefix, PrefixGetter getter)
+{
+	prefixes.emplace_back(prefix, getter);
+}
+
+bool Variables::get(const String& name, String& value)
+{
+	if (!table.empty())
+	{
+		uint8_t index = table[findSlot(name.c_str(), hashName(name.c_str()))];
+		if (index != NONE)
+		{
+			const auto& v = variables[index];
+			switch (v.type)
+			{
+				case Type::TEXT:
+					value = v.text();
+					break;
+
+				case Type::INT:
+				{
+					int32_t i = v.integer();
+					if (i == INT32_MIN)
+						return false;
+
+					value = String(i);
+					if (v.unit)
+						value += v.unit;
+					break;
+				}
+
+				case Type::FLOAT:
+				{
+					float f = v.real();
+					if (isnan(f))
+						return false;
+
+					value = String(f, v.decimals);
+					break;
+				}
+			}
+			return value.length();
+		}
+	}
+
+	for (const auto& p: prefixes)
+	{
+		if (!name.startsWith(p.first))
+			continue;
+
+		value = p.second(name.substring(p.first.length()));
+		if (value.length())
+			return true;
+	}
+
+	return false;
+}
+
+void Variables::forEach(std::function<void(const String& name, Type type)> callback)
+{
+	for (const auto& v: variables)
+		callback(v.name, v.type);
+}
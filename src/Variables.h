@@ -0,0 +1,43 @@
+/*
+ * Variables.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef VARIABLES_H_
+#define VARIABLES_H_
+
+#include "Arduino.h"
+#include <functional>
+
+//The values computed when they are read ($ip$ on the status page, an MQTT request,
+//mqttReports, $heap on the serial port), registered by the code that owns them.
+//The names are not case sensitive and are found by their hash; the names under a
+//prefix ("task.", "timers.") are handled by one getter of the rest of the name.
+namespace Variables
+{
+	enum class Type: uint8_t {TEXT, INT, FLOAT};
+
+	using TextGetter = std::function<String()>;
+	//INT32_MIN - no value
+	using IntGetter = std::function<int32_t()>;
+	//NAN - no value
+	using FloatGetter = std::function<float()>;
+	//the name without the prefix, an empty string - no value
+	using PrefixGetter = std::function<String(const String& name)>;
+
+	//a name registered again replaces the getter
+	void addText(const String& name, TextGetter getter);
+	void addInt(const String& name, IntGetter getter, const char* unit = nullptr);
+	void addFloat(const String& name, FloatGetter getter, uint8_t decimals = 1);
+	void addPrefix(const String& prefix, PrefixGetter getter);
+
+	//false if there is no such variable or it has no value now
+	bool get(const String& name, String& value);
+
+	//the registered names in the order of registration, without the prefixed ones
+	void forEach(std::function<void(const String& name, Type type)> callback);
+}
+
+#endif /* VARIABLES_H_ */
@@ -11,6 +11,10 @@
 #include "tasks_utils.h"
 #include <MapCollector.hpp>
 #include "web_utils.h"
+#include "TraceRecorder.h"
+#include "WorkItem.h"
+#include "ConfigSchema.h"
+#include "Variables.h"
 
 /*
  * 2660646 - Geneva
@@ -21,10 +25,11 @@
 
 using namespace std;
 
-const static char urlTemplate[] PROGMEM =
-		"http://api.openweathermap.org/data/2.5/weather?id=%d&APPID=%s&units=metric";
-const static char urlForecastTemplate[] PROGMEM =
-		"http://api.openweathermap.org/data/2.5/forecast?id=%d&APPID=%s&units=metric&cnt=2";
+const static char owmHost[] = "api.openweathermap.org";
+const static char pathTemplate[] PROGMEM =
+		"/data/2.5/weather?id=%d&APPID=%s&units=metric";
+const static char pathForecastTemplate[] PROGMEM =
+		"/data/2.5/forecast?id=%d&APPID=%s&units=metric&cnt=2";
 
 
 /* forecast path
@@ -54,14 +59,18 @@ bool jsonPathFilter(const string& key, const string& /*value*/)
 	return false;
 }
 
-WeatherGetter::WeatherGetter()
+WeatherGetter::WeatherGetter():
+	mc(jsonPathFilter)
 {
 	registerPage(F("owms"), F("OWM Status"), [this](ESP8266WebServer& ws) {handleStatus(ws);});
 
 	addRegularMessage({this, [this](){return getWeatherDescription();}, 0.035_s, 1, true});
 
-	//wait for the network
-	suspend();
+	//the first location, empty till it's read
+	Variables::addText(F("owm.location"), [this]() {return weathers.empty() ? String(): weathers[0].location;});
+	Variables::addFloat(F("owm.temperature"), [this]() {return weathers.empty() || weathers[0].location.isEmpty() ? NAN: weathers[0].temperature;});
+	Variables::addFloat(F("owm.forecast"), [this]() {return weathers.empty() || weathers[0].description.isEmpty() ? NAN: weathers[0].temperatureForecast;});
+	Variables::addText(F("owm.description"), [this]() {return weathers.empty() ? String(): weathers[0].description;});
 }
 
 void WeatherGetter::reset()
@@ -92,104 +101,167 @@ void WeatherGetter::reset()
 	logPrintfX(F("WG"), F("Found %d IDs"), weathers.size());
 
 	currentWeatherIndex = 0;
+
+	//a request in progress is abandoned
+	client.stop();
+	coRestart();
 }
 
 
 
-int getHttpResponse(WiFiClient& wifiClient, HTTPClient& httpClient, MapCollector& mc, const char* url)
+//connecting and sending are still blocking, the response is read in steps
+bool WeatherGetter::startRequest(const Weather& w)
 {
-	httpClient.begin(wifiClient, url);
-
-	int httpCode = httpClient.GET();
+	static uint16_t traceGet = Trace::registerName(F("owm.get"));
+	Trace::Scope scope(traceGet);
 
-	if (httpCode != 200)
-	{
-		httpClient.end();
-		return httpCode;
-	}
+	char path[160];
+	snprintf_P(path, sizeof(path), requestIndex ? pathForecastTemplate: pathTemplate, w.locationId, apiKey.c_str());
+	logPrintfX(F("WG"), "GET %s", path);
 
+	code = 0;
+	inBody = false;
+	line = String();
 	mc.reset();
 
-	String json = httpClient.getString();
-	for (size_t  i = 0; i < json.length(); ++i)
+	if (!client.connect(owmHost, 80))
+		return false;
+
+	//HTTP/1.0 - no chunks, the body ends with the connection
+	client.print(F("GET "));
+	client.print(path);
+	client.print(F(" HTTP/1.0\r\nHost: "));
+	client.print(owmHost);
+	client.print(F("\r\nConnection: close\r\n\r\n"));
+	return true;
+}
+
+//consumes what has arrived: the status line, the headers and then the JSON,
+//returns false if the time of the slice ran out before that
+bool WeatherGetter::readResponse()
+{
+	static uint16_t traceParse = Trace::registerName(F("owm.parse"));
+	Trace::Scope scope(traceParse);
+
+	SliceBudget budget;
+
+	while (client.available())
 	{
-		mc.parse(json[i]);
-	}
+		if (budget.expired())
+			return false;
 
-	httpClient.end();
 
-	return httpCode;
-}
+		char c = client.read();
+		if (inBody)
+		{
+			mc.parse(c);
+			continue;
+		}
+
+		if (c == '\r')
+			continue;
 
+		if (c != '\n')
+		{
+			line += c;
+			continue;
+		}
+
+		//"HTTP/1.1 200 OK", the headers end with an empty line
+		if (code == 0)
+		{
+			code = line.substring(line.indexOf(' ') + 1).toInt();
+			if (code == 0)
+				code = -1;
+		}
+		else if (line.length() == 0)
+			inBody = true;
+
+		line = String();
+	}
+
+	return true;
+}
 
 void WeatherGetter::run()
 {
+	CO_BEGIN();
+
 	//if no weathers are configured or apiKey is missing...
 	if (weathers.size() == 0 or apiKey.length() == 0)
 	{
 		logPrintfX(F("WG"), F("Service not configured... "));
 		sleep(60_s);
-		return;
+		CO_RETURN();
 	}
 
-	Weather& w = weathers[currentWeatherIndex];
-	logPrintfX(F("WG"), "Reading weather for id = %d", w.locationId);
-
-	currentWeatherIndex++;
-	currentWeatherIndex %= weathers.size();
-
-	//locals needed for the rest of the code
-	MapCollector mc(jsonPathFilter);
-	WiFiClient wifiClient;
-	HTTPClient httpClient;
-	httpClient.setReuse(true);
-	char localBuffer[256];
-	int code = 0;
+	logPrintfX(F("WG"), "Reading weather for id = %d", weathers[currentWeatherIndex].locationId);
 
-	while (true)
+	for (requestIndex = 0; requestIndex < 2; ++requestIndex)
 	{
-		//get weather
-		snprintf_P(localBuffer, sizeof(localBuffer), urlTemplate, w.locationId, apiKey.c_str());
-		logPrintfX(F("WG"), "URL: %s", localBuffer);
-		code = getHttpResponse(wifiClient, httpClient, mc, localBuffer);
-		if (code != 200)
+		//the connect is blocking, it waits for an idle window
+		if (requestIndex)
+			CO_YIELD();
+
+		if (!startRequest(weathers[currentWeatherIndex]))
+		{
+			code = -1;
 			break;
+		}
 
-		auto& results = mc.getValues();
-		w.temperature = atof(results["/root/main/temp"].c_str());
-		w.location = results["/root/name"].c_str();
+		while (client.connected() || client.available())
+		{
+			CO_AWAIT_READABLE(client, HTTP_TIMEOUT_MS);
+			if (coTimedOut)
+			{
+				code = -1;
+				break;
+			}
+			//the rest of the data is parsed in the next pass
+			if (!readResponse())
+				CO_YIELD_SHORT();
+		}
+		client.stop();
 
-		//get forecast
-		snprintf_P(localBuffer, sizeof(localBuffer), urlForecastTemplate, w.locationId, apiKey.c_str());
-		logPrintfX(F("WG"), "URL: %s", localBuffer);
-		code = getHttpResponse(wifiClient, httpClient, mc, localBuffer);
 		if (code != 200)
 			break;
 
-		w.temperatureForecast = atof(results["/root/list/1/main/temp"].c_str());
-		w.description = results["/root/list/1/weather/0/description"].c_str();
-
-		//oops, forgot to break...
-		break;
+		auto& results = mc.getValues();
+		auto& w = weathers[currentWeatherIndex];
+		if (requestIndex == 0)
+		{
+			w.temperature = atof(results["/root/main/temp"].c_str());
+			w.location = results["/root/name"].c_str();
+			if (currentWeatherIndex == 0)
+				history.add(w.temperature);
+		}
+		else
+		{
+			w.temperatureForecast = atof(results["/root/list/1/main/temp"].c_str());
+			w.description = results["/root/list/1/weather/0/description"].c_str();
+		}
 	}
+
+	currentWeatherIndex++;
+	currentWeatherIndex %= weathers.size();
+
 	if (code != 200)
 	{
 		logPrintfX(F("WG"), F("HTTP failed with code %d"), code);
 		sleep(600_s);
-		return;
+		CO_RETURN();
 	}
 
 	if (currentWeatherIndex != 0)
 	{
 		sleep(5_s);		//one readout every 5 seconds, then longer break...
-		return;
+		CO_RETURN();
 	}
 
-	int period = readConfig(F("owmPeriod")).toInt() * 1_s;
-	if (period == 0)
-		period = 600_s;
+	//owmPeriod is in seconds and may be longer than Task::sleep can count
+	sleepFor(this, Config::getInt(Config::OWM_PERIOD) * 1000);
 
-	sleep(period);
+	CO_END();
 }
 
 static const char owmStatusPage[] PROGMEM = R"_(
@@ -9,11 +9,15 @@
 #define WEATHERGETTER_H_
 
 #include <tasks.hpp>
-#include "ESP8266HTTPClient.h"
+#include <WiFiClient.h>
+#include <MapCollector.hpp>
 #include <vector>
 
 #include <ESP8266WebServer.h>
-class WeatherGetter: public Tasks::Task
+#include "Coroutine.h"
+#include "TimeSeries.h"
+
+class WeatherGetter: public Tasks::Task, public Coroutine
 {
 	public:
 		WeatherGetter();
@@ -40,8 +44,22 @@ class WeatherGetter: public Tasks::Task
 
 		uint32_t currentWeatherIndex;
 
+		//the temperature of the first location: 48 h of the readouts, a month of hours
+		TimeSeries history{F("owm"), {{600, 288}, {3600, 720}}, 10, true};
+
 		String apiKey;
 
+		//state of the request in progress
+		WiFiClient client;
+		MapCollector mc;
+		uint8_t requestIndex;	//0 - current weather, 1 - forecast
+		int code;				//HTTP status, 0 - not read yet, -1 - failed
+		bool inBody;
+		String line;
+
+		bool startRequest(const Weather& w);
+		bool readResponse();
+
 		//page handling
 		void handleConfig(ESP8266WebServer& ws);
 		void handleStatus(ESP8266WebServer& ws);
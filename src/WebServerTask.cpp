@@ -18,32 +18,49 @@
 #include "MacroStringReplace.h"
 #include "config.h"
 #include "DataStore.h"
+#include "ConfigSchema.h"
+#include "ConfigCache.h"
+#include "ConfigJournal.h"
 
 #include "html/webpage.h"
 
 #include "utils.h"
 #include "tasks_utils.h"
 #include "web_utils.h"
-#include "LambdaTask.hpp"
+#include "TraceRecorder.h"
 
 
 
 WebServerTask::WebServerTask():
-		webServer(80)
+		webServer(80),
+		poll(this, WEB_POLL_MIN, WEB_POLL_MAX)
 {
 	reset();
 	DisplayState ds{this, [this]() {return webmessage;}, 0.05_s, 1, true};
 	addRegularMessage(ds);
 }
 
+//pages without a label are not listed on the main page
 void WebServerTask::registerPage(const String& url, const String& label,
 		std::function<void(ESP8266WebServer& ws)> ph)
 {
-	registeredPages.emplace_back(url, label);
+	if (label.length())
+		registeredPages.emplace_back(url, label);
 	String newUrl("/");
 	newUrl += url;
-	std::function<void(void)> f = [this, ph] () {ph(webServer);};
-	webServer.on(newUrl.c_str(), f);
+	on(newUrl, [this, ph] () {ph(webServer);});
+}
+
+//every handler is recorded by the trace recorder
+void WebServerTask::on(const String& url, std::function<void(void)> handler)
+{
+	uint16_t traceId = Trace::registerName(String(F("web")) + url);
+	webServer.on(url.c_str(), [this, traceId, handler]()
+	{
+		handled = true;
+		Trace::Scope scope(traceId);
+		handler();
+	});
 }
 
 void WebServerTask::reset()
@@ -65,18 +82,19 @@ void WebServerTask::run()
 		logPrintfX(F("WST"), F("Configuring server"));
 
 		webServer.onNotFound([this](){
+			handled = true;
 			webServer.send(404, "text/plain", "Not found... :/");
 		});
 
-		webServer.on("/", [this](){
+		on("/", [this](){
 			handleMainPage();
 		});
 
-		webServer.on("/webmessage", [this](){handleWebMessage();});
-		webServer.on("/status", 	[this](){handleStatus();});
-		webServer.on("/reset", [this]{handleReset();});
-		webServer.on("/config", [this]{handleConfig();});
-		webServer.on("/log", [this](){handleLogs();});
+		on("/webmessage", [this](){handleWebMessage();});
+		on("/status", 	[this](){handleStatus();});
+		on("/reset", [this]{handleReset();});
+		on("/config", [this]{handleConfig();});
+		on("/log", [this](){handleLogs();});
 
 		webServer.begin();
 
@@ -86,6 +104,11 @@ void WebServerTask::run()
 
 	webServer.handleClient();
 	delay(0);
+
+	//a request being read or a connection kept open counts as activity too
+	bool activity = handled || webServer.client().connected();
+	handled = false;
+	sleepFor(this, poll.next(activity));
 }
 
 String WebServerTask::generateLinks()
@@ -189,10 +212,21 @@ void WebServerTask::handleConfig()
 	if (!handleAuth(webServer))
 		return;
 
+	//one value: key=<key>&value=<value>, an empty value removes the key
+	if (webServer.method() == HTTP_PATCH)
+	{
+		bool ok = ConfigJournal::set(webServer.arg(F("key")), webServer.arg(F("value")));
+		webServer.send(ok ? 200: 400, textPlain, ok ? F("OK"): F("Invalid key or value"));
+		return;
+	}
+
 	String content;
 
 	if (webServer.method() == HTTP_GET)
 	{
+		//the single changes are shown in the file as well
+		ConfigJournal::compact();
+
 		//read config from the file
 		LittleFS.begin();
 		auto file = LittleFS.open("/config.txt", "r");
@@ -211,6 +245,8 @@ void WebServerTask::handleConfig()
 		//POST
 		//load content from variable
 		content = webServer.arg(F("content"));
+		ConfigCache::invalidate();
+		ConfigJournal::clear();
 		LittleFS.begin();
 		auto file = LittleFS.open("/config.txt", "w+");
 		file.print(content);
@@ -219,9 +255,22 @@ void WebServerTask::handleConfig()
 		readConfigFromFS();
 	}
 	
+	//the values that were not accepted when the configuration was loaded
+	String errors;
+	for (const auto& e: Config::getErrors())
+	{
+		errors += F("<tr><td colspan=\"3\" class=\"l\">&#9888; ");
+		errors += e;
+		errors += F("</td></tr>");
+	}
+
 	StringStream ss(2048);
 	macroStringReplace(pageHeaderFS, constString(F("Config")), ss);
-	macroStringReplace(configPageFS, constString(content), ss);
+	std::map<String, String> m = {
+		{F("configFileContents"), content},
+		{F("configErrors"), errors},
+	};
+	macroStringReplace(configPageFS, mapLookup(m), ss);
 	webServer.send(200, textHtml, ss.buffer);
 }
 
@@ -13,6 +13,7 @@
 #include <tasks.hpp>
 #include "Arduino.h"
 #include "ESP8266WebServer.h"
+#include "AdaptivePoll.h"
 
 class WebServerTask: public Tasks::Task {
 public:
@@ -44,10 +45,14 @@ private:
 	void handleLogs();
 	
 	String generateLinks();
+	void on(const String& url, std::function<void(void)> handler);
 
 	ESP8266WebServer webServer;
 	std::vector<std::pair<String, String>> registeredPages;
 
+	AdaptivePoll poll;
+	bool handled = false;		//a handler has run since the last poll
+
 
 
 };
@@ -46,6 +46,12 @@ void WifiConnector::lateInit()
 }
 
 
+void WifiConnector::reset()
+{
+	mainState = States::CLIENT;
+	nextState = &WifiConnector::lateInit;
+}
+
 void WifiConnector::initAP()
 {
 	//run the AP
@@ -118,12 +124,8 @@ static void wifiConnectorCallback(WifiConnector::States state)
 	switch (state)
 	{
 		case WifiConnector::States::NONE:
-			//suspend connected tasks
-			for (const auto& td: getTasks())
-			{
-				if (td.flags & TaskDescriptor::CONNECTED)
-					td.task->suspend();
-			}
+			//connected tasks are parked when due
+			closeGate(TaskDescriptor::CONNECTED);
 			return;
 
 		case WifiConnector::States::AP:
@@ -132,7 +134,7 @@ static void wifiConnectorCallback(WifiConnector::States state)
 
 			DisplayTask::getInstance().pushMessage(F("AP mode"), 10_s);
 			String ip = WiFi.softAPIP().toString();
-			DataStore::value("ip") = ip;
+			DataStore::set("ip", ip);
 			logPrintfX(F("WC"), F("IP = %s"), ip.c_str());
 			return;
 		}
@@ -148,7 +150,7 @@ static void wifiConnectorCallback(WifiConnector::States state)
 			String ip = WiFi.localIP().toString();
 			DisplayTask::getInstance().pushMessage(ip, 0.1_s, true);
 
-			DataStore::value(F("ip")) = ip;
+			DataStore::set(F("ip"), ip);
 			logPrintfX(F("WC"), F("IP = %s"), ip.c_str());
 
 			ArduinoOTA.begin();
@@ -158,9 +160,10 @@ static void wifiConnectorCallback(WifiConnector::States state)
 				if (td.flags & TaskDescriptor::CONNECTED)
 				{
 					td.task->reset();
-					td.task->resume();
+					wakeTask(td.task);
 				}
 			}
+			openGate(TaskDescriptor::CONNECTED);
 			break;
 		}
 	}
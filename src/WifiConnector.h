@@ -34,6 +34,9 @@ class WifiConnector: public Tasks::TaskCRTP<WifiConnector>
 		void monitorClientStatus();
 		bool getConnected() const;
 
+		//connects again, with the current essid and password
+		virtual void reset();
+
 		static WifiConnector& getInstance();
 
 	private:
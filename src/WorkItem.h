@@ -0,0 +1,74 @@
+/*
+ * WorkItem.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef WORKITEM_H_
+#define WORKITEM_H_
+
+#include "Arduino.h"
+#include "config.h"
+
+//Time spent by a task in one pass, for the work that can stop at any point
+class SliceBudget
+{
+	public:
+		SliceBudget(uint32_t us = WORK_SLICE_US): start(micros()), us(us) {}
+
+		bool expired() const {return micros() - start >= us;}
+
+	private:
+		uint32_t start;
+		uint32_t us;
+};
+
+//A long computation done in slices: step() does a small piece of it and keeps
+//the progress in the object, runSlice() calls it till the work is done or the
+//budget is spent. The owner task calls runSlice() in every pass and doesn't
+//sleep till it returns true.
+class WorkItem
+{
+	public:
+		virtual ~WorkItem() = default;
+
+		//true when the work is finished
+		bool runSlice(uint32_t budgetUs = WORK_SLICE_US)
+		{
+			if (done)
+				return true;
+
+			SliceBudget budget(budgetUs);
+			slices++;
+
+			do
+			{
+				done = step();
+			}
+			while (!done && !budget.expired());
+
+			return done;
+		}
+
+		bool isDone() const {return done;}
+		//slices the last (or the current) work took
+		uint16_t getSlices() const {return slices;}
+
+	protected:
+		//called when the new work is set up
+		void restartWork()
+		{
+			done = false;
+			slices = 0;
+		}
+
+		//one piece of the work, true when nothing is left
+		virtual bool step() = 0;
+
+	private:
+		bool done = true;
+		uint16_t slices = 0;
+};
+
+#endif /* WORKITEM_H_ */
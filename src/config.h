@@ -22,12 +22,55 @@ const static uint8_t LED_CS = D8;		//to SS
 #define LED_DISPLAYS 1
 
 const static int32_t MS_PER_CYCLE = 10;
+//a slow task that never fits an idle window of the display is run anyway after this time (ms)
+const static uint32_t SLOW_TASK_MAX_WAIT = 60000;
+//a period set at run time replaces only the sleeps at least this long (ms), shorter ones are steps of a job
+const static uint32_t TASK_PERIOD_OVERRIDE_MIN = 1000;
+//the main loop sleeps when no task is due, but wakes up at least this often (ms)
+const static uint32_t MAX_IDLE_MS = 100;
+
+//adaptive polling of the I/O tasks (ms) - right after some activity and the cap when idle
+const static uint16_t WEB_POLL_MIN = 10;
+const static uint16_t WEB_POLL_MAX = 200;
+const static uint16_t MQTT_POLL_MIN = 50;
+const static uint16_t MQTT_POLL_MAX = 1000;
+//the RX buffer of the UART (256 bytes) fills in ~22 ms at full speed, fine for typed commands
+const static uint16_t SERIAL_POLL_MIN = 20;
+const static uint16_t SERIAL_POLL_MAX = 250;
 
 //Local Sensor Task
 const static uint8_t ONE_WIRE_TEMP = D3;
 //use this define if you have no free ground pin and want to use some DIO
 #define OW_GND D2
 
+//Messages Task - max number of messages kept in the flash (16 bytes of RAM each)
+const static uint16_t MESSAGE_STORE_CAPACITY = 1024;
+
+//Timer service - number of one-shot and periodic timers that can be pending at once
+const static uint8_t TIMER_POOL_SIZE = 8;
+
+//Config journal - size (bytes) of /config.jnl that makes it merged into /config.txt
+const static size_t CONFIG_JOURNAL_MAX = 1024;
+
+//HTTP fetchers read the response in steps, it may take this long to arrive after the request (ms)
+const static uint32_t HTTP_TIMEOUT_MS = 10000;
+
+//Work items - CPU time a long computation (rendering, parsing) may take in one pass
+const static uint32_t WORK_SLICE_US = 2000;
+
+//Trace recorder - number of events in the ring buffer (8 bytes each), has to be a power of two
+const static uint16_t TRACE_BUFFER_SIZE = 512;
+//distinct names of tasks and activities, the extra ones are recorded as "other"
+const static uint16_t TRACE_MAX_NAMES = 64;
+
+//Stall watchdog - checks the loop from the timer1 interrupt every STALL_TICK_MS,
+//the threshold is stallThreshold (ms, 0 - off, 2000 by default)
+const static uint32_t STALL_TICK_MS = 100;
+//records kept in the RTC user memory, STALL_RTC_OFFSET words after the OTA (eboot) command
+const static uint8_t STALL_RECORDS = 4;
+const static uint8_t STALL_STACK_SAMPLE = 8;
+const static uint8_t STALL_RTC_OFFSET = 32;
+
 const static char versionString[] = "v 0.5.7";
 
 const static char DEFAULT_USER[] = "user";
@@ -44,11 +44,15 @@ static const char statusPage[] PROGMEM = R"_(
 <tr><td class="l">Version:</td><td>$version$ - $build$</td></tr>
 <tr><td class="l">Free heap:</td><td>$heap$</td></tr>
 <tr><td class="l">Up time:</td><td>$uptime$</td></tr>
+<tr><td class="l">Config load:</td><td>$configload$</td></tr>
 <tr><th>WiFi</th></tr>
 <tr><td class="l">essid:</td><td>$essid$</td></tr>
 <tr><td class="l">IP:</td><td>$ip$</td></tr>
 <tr><td class="l">Name:</td><td>$hostname$</td></tr>
 ><tr><td class="l">MAC Address:</td><td>$mac$</td></tr>
+<tr><th>Timers</th></tr>
+<tr><td class="l">Used:</td><td>$timers.used$ of $timers.size$</td></tr>
+<tr><td class="l">High-water mark:</td><td>$timers.max$</td></tr>
 </table>
 </body>
 </html>
@@ -85,6 +89,7 @@ static const char configPage[] PROGMEM = R"_(
    <form action="/config" method="POST">
    <table>
       <tr><th>Config</th><th width="50%"/><th/></tr>
+$configErrors$
       <tr><td colspan="3"><textarea cols="60" rows="40" autofocus="true" name="content">$configFileContents$</textarea></td></tr>
       <tr><td/><td/><td><input type="submit" value="Save"></td></tr>
     </table>
@@ -8,6 +8,7 @@
 #include "utils.h"
 #include "OTA.hpp"
 #include "SyslogSender.h"
+#include "StallWatchdog.h"
 
 #include "DisplayTask.hpp"
 
@@ -36,10 +37,14 @@ void setup()
 	syslogServer = readConfig(F("syslogServer"));
 
 	configureOTA();
+
+	StallWatchdog::init();
 }
 
 void loop()
 {
+	StallWatchdog::feed();
 	scheduleTasks();
 	ArduinoOTA.handle();
+	idleUntilNextTask(MAX_IDLE_MS);
 }
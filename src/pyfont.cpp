@@ -6,32 +6,49 @@ size_t calculateRenderedLength(const PyFont& f, const char* text)
 
   while (char c = *text++)
   {
-    outputLen  += f.getCharSize(c) + 1;   //char spacing == 1
+    outputLen  += f.getCharWidth(c);
   }
   //FIXME: we can remove the last spacing at the end
 
   return outputLen;
 }
 
+int renderChar(const PyFont& f, char c, uint8_t* output, int maxSize)
+{
+  if (isSparkBar(c))
+  {
+    //bit 7 is the bottom row
+    uint8_t height = c - SPARK_BAR;
+    *output = height ? 0xFF << (8 - height): 0;
+    return 1;
+  }
+
+  int outputLen = 0;
+
+  uint8_t        size = f.getCharSize(c);
+  const uint8_t* ptr  = f.getCharData(c);
+
+  for (uint8_t j = 0; j < size; j++)
+  {
+    *output++ = ptr[j];
+    outputLen++;
+    if (outputLen >= maxSize)
+      return outputLen;
+  }
+
+  *output++ = 0;
+  outputLen++;
+
+  return outputLen;
+}
+
 int renderText(const PyFont& f, const char* text, uint8_t* output, int maxSize)
 {
   int outputLen = 0;
 
   while (char c = *text++)
   {
-    uint8_t        size = f.getCharSize(c);
-    const uint8_t* ptr  = f.getCharData(c);
-
-    for (uint8_t j = 0; j < size; j++)
-    {
-      *output++ = ptr[j];
-      outputLen++;
-      if (outputLen >= maxSize)
-        return outputLen;
-    }
-
-    *output++ = 0;
-    outputLen++;
+    outputLen += renderChar(f, c, output + outputLen, maxSize - outputLen);
     if (outputLen >= maxSize)
       return outputLen;
   }
@@ -4,6 +4,16 @@
 #include <stdint.h>
 #include <stddef.h>
 
+//characters SPARK_BAR...SPARK_BAR+8 are the columns of a sparkline, 0-8 rows
+//high from the bottom, one column each without the spacing, in every font
+const char SPARK_BAR = 1;
+const uint8_t SPARK_LEVELS = 9;
+
+inline bool isSparkBar(char ch)
+{
+    return ch >= SPARK_BAR && ch < SPARK_BAR + SPARK_LEVELS;
+}
+
 struct PyFont
 {
     PyFont(uint8_t chars, uint8_t baseChar, const uint8_t* data, const uint16_t* offsets, const uint8_t* sizes):
@@ -23,6 +33,12 @@ struct PyFont
         return sizes[o];
     }
 
+    //the columns taken by the character with the spacing after it
+    uint8_t getCharWidth(char ch) const
+    {
+        return isSparkBar(ch) ? 1: getCharSize(ch) + 1;   //char spacing == 1
+    }
+
     const uint8_t* getCharData(char ch) const
     {
         if ((ch < baseChar) || (ch > (chars + baseChar)))
@@ -33,6 +49,8 @@ struct PyFont
 };
 
 
+//one character and the spacing after it, returns the number of columns written
+int renderChar(const PyFont& f, char c, uint8_t* output, int maxSize);
 int renderText(const PyFont& f, const char* text, uint8_t* output, int maxSize);
 size_t calculateRenderedLength(const PyFont& f, const char* text);
 
@@ -6,6 +6,7 @@
  */
 
 #include <vector>
+#include <algorithm>
 
 #include "Arduino.h"
 #include "ArduinoOTA.h"
@@ -16,6 +17,12 @@
 #include "DataStore.h"
 
 #include "WebServerTask.h"
+#include "web_utils.h"
+#include "TraceRecorder.h"
+#include "TimerService.h"
+#include "TimeSeries.h"
+#include "Variables.h"
+#include "AdaptivePoll.h"
 #include "WifiConnector.h"
 #include "DisplayTask.hpp"
 
@@ -35,97 +42,342 @@ extern "C" {
 #include "user_interface.h"
 }
 
+#include <coredecls.h>
+
 using namespace Tasks;
 
-bool slowTaskCanExecute = false;
+static const char tasksPageHeader[] PROGMEM = R"_(
+<table>
+<tr><th>Task</th><th>Flags</th><th>State</th><th>Calls</th><th>Total [ms]</th><th>Avg [us]</th><th>Max [us]</th>
+<th>&lt;0.1ms/1ms/10ms/100ms/1s/more</th><th>Late avg [ms]</th><th>Late max [ms]</th><th>Missed</th>
+<th>Poll [ms]</th><th>Poll gap avg/max [ms]</th><th>Last run [s]</th><th>Period [ms]</th><th>Control</th></tr>
+)_";
 
-std::vector<TaskDescriptor>& getTasks()
-{
-	static std::vector<TaskDescriptor> tasks;
-	return tasks;
-}
+static const char tasksPageRow[] PROGMEM = R"_(
+<tr><td>$name$</td><td>$flags$</td><td>$state$</td><td>$calls$</td><td>$total$</td><td>$avg$</td><td>$max$</td><td>$hist$</td><td>$late$</td><td>$latemax$</td><td>$missed$</td><td>$poll$</td><td>$pollgap$/$pollgapmax$</td><td>$last$</td>
+<td><form action="tasks" method="post"><input type="hidden" name="task" value="$name$"><input type="hidden" name="action" value="period">
+<input name="ms" size="7" value="$period$"><input type="submit" value="Set"></form></td>
+<td><form action="tasks" method="post"><input type="hidden" name="task" value="$name$">
+<button name="action" value="suspend">Suspend</button> <button name="action" value="resume">Resume</button></form></td></tr>
+)_";
+
+static const char tasksPageFooter[] PROGMEM = R"_(
+</table></body>
+<script>setInterval(function(){if (document.activeElement.tagName != "INPUT") window.location.reload(1);}, 5000);</script>
+</html>
+)_";
 
-static os_timer_t myTimer;
+FlashStream tasksPageHeaderFS(tasksPageHeader);
+FlashStream tasksPageRowFS(tasksPageRow);
+FlashStream tasksPageFooterFS(tasksPageFooter);
 
-static void timerCallback(void*)
+static const char* stateName(const TaskDescriptor& td)
 {
-	for (auto& td: getTasks())
-		updateSleepSingle(td.task);
+	if (td.paused)
+		return "PAUSED";
+
+	if (td.queued)
+		return "QUEUED";
+
+	if (td.parked)
+		return "PARKED";
+
+	switch (td.task->getState())
+	{
+		case Tasks::State::READY: return "READY";
+		case Tasks::State::SLEEPING: return "SLEEPING";
+		case Tasks::State::SUSPENDED: return "SUSPENDED";
+		case Tasks::State::KILLED: return "KILLED";
+	}
+	return "?";
 }
 
-void setupTasks()
+static String taskStatistic(const TaskDescriptor& td, const String& stat)
 {
-	addTask(&WifiConnector::getInstance());
-	addTask(&WebServerTask::getInstance());
-	addTask(&DisplayTask::getInstance());
+	const auto& s = td.stats;
+	uint32_t mhz = ESP.getCpuFreqMHz();
 
-	addTask(new SerialCommandTask, 0);
-	addOptionalTask<LHCStatusReaderNew>(F("lhcEnabled"), TaskDescriptor::CONNECTED | TaskDescriptor::SLOW);
-	addOptionalTask<LEDBlinker>(F("ledEnabled"), 0);
-	addOptionalTask<WeatherGetter>(F("owmEnabled"), TaskDescriptor::SLOW | TaskDescriptor::CONNECTED);
-	addOptionalTask<MQTTTask>(F("mqttEnabled"), TaskDescriptor::CONNECTED);
-	addOptionalTask<LocalSensorTask>(F("lstEnabled"), TaskDescriptor::SLOW);
-	addOptionalTask<MessagesTask>(F("messagesEnabled"), TaskDescriptor::CONNECTED);
-	addOptionalTask<RestaurantMenuTask>(F("menuEnabled"), TaskDescriptor::SLOW | TaskDescriptor::CONNECTED);
+	if (stat == F("calls"))
+		return String(s.calls);
+
+	if (stat == F("total"))
+		return String((uint32_t)(s.totalCycles / (mhz * 1000)));
+
+	if (stat == F("avg"))
+		return String(s.calls ? (uint32_t)(s.totalCycles / s.calls / mhz): 0);
+
+	if (stat == F("max"))
+		return String(s.maxCycles / mhz);
+
+	if (stat == F("late"))
+		return String(s.lateAvg / 1000.0f, 1);
+
+	if (stat == F("latemax"))
+		return String(s.lateMax / 1000.0f, 1);
+
+	if (stat == F("missed"))
+		return String(s.missed);
 
-	os_timer_setfn(&myTimer, timerCallback, NULL);
-	os_timer_arm(&myTimer, MS_PER_CYCLE, true);
+	//only the tasks that poll with AdaptivePoll
+	const AdaptivePoll* poll = AdaptivePoll::find(td.task);
+	if (stat == F("poll"))
+		return poll ? String(poll->getInterval()): String("-");
+
+	if (stat == F("pollgap"))
+		return poll ? String(poll->getGapAvg()): String("-");
+
+	if (stat == F("pollgapmax"))
+		return poll ? String(poll->getGapMax()): String("-");
+
+	if (stat == F("period"))
+		return td.periodOverride ? String(td.periodOverride): String();
+
+	if (stat == F("last"))
+		return s.calls ? String((millis() - s.lastRun) / 1000): String("-");
+
+	if (stat == F("hist"))
+	{
+		String r;
+		for (uint8_t i = 0; i < TaskStats::BINS; ++i)
+		{
+			if (i)
+				r += '/';
+			r += String(s.histogram[i]);
+		}
+		return r;
+	}
+
+	return String();
 }
 
-void addTask(const TaskDescriptor& td)
+String getTaskStatistic(const String& name)
 {
-	getTasks().emplace_back(td);
+	int dot = name.lastIndexOf('.');
+	if (dot == -1)
+		return String();
+
+	String taskName = name.substring(0, dot);
+	for (const auto& td: getTasks())
+	{
+		if (td.name == taskName)
+			return taskStatistic(td, name.substring(dot + 1));
+	}
+
+	return String();
 }
 
-Tasks::Task* addTask(Tasks::Task* t, uint8_t flags)
+//plain digits only, toInt() would take "-1" or "5x" too; 9 of them - under 12 days
+static bool isPeriod(const String& ms)
 {
-	getTasks().emplace_back(t, flags);
-	return t;
-}
+	if (ms.length() == 0 || ms.length() > 9)
+		return false;
 
-template <class T>
-using TaskMemberWebCallback = void (T::*)(ESP8266WebServer&);
+	for (size_t i = 0; i < ms.length(); ++i)
+	{
+		if (!isdigit(ms[i]))
+			return false;
+	}
+	return true;
+}
 
-template <class T>
-void registerPage(const String& url, const String& label, T* task, TaskMemberWebCallback<T> callback)
+String controlTask(const String& command)
 {
-	WebServerTask::getInstance().registerPage(url, label,
-	[task, callback](ESP8266WebServer& ws) {task->*callback(ws);});
-}
+	auto words = tokenize(command, " ");
+	if (words.size() < 2)
+		return F("Usage: <task> suspend|resume|period <ms>");
 
+	const String& name = words[0];
+	const String& action = words[1];
+	bool found;
 
-void scheduleTasks()
+	for (const auto& td: getTasks())
+	{
+		if (td.name == name && (td.flags & TaskDescriptor::SYSTEM))
+		{
+			String result = name + F(" is a system task, it can't be controlled");
+			logPrintfX(F("TSK"), F("%s"), result.c_str());
+			return result;
+		}
+	}
+
+	if (action == F("suspend") || action == F("resume"))
+		found = pauseTask(name, action == F("suspend"));
+	else if (action == F("period") && words.size() > 2 && isPeriod(words[2]))
+		found = setTaskPeriod(name, words[2].toInt());
+	else
+		return F("Usage: <task> suspend|resume|period <ms>");
+
+	String result = found ? command: String(F("Unknown task: ")) + name;
+	logPrintfX(F("TSK"), F("%s"), result.c_str());
+	return result;
+}
+
+static void handleTasksPage(ESP8266WebServer& webServer)
 {
-	for (auto& td: getTasks())
+	//a command changes the state, a link (or a cross-site request) can't send it
+	if (webServer.method() == HTTP_POST && webServer.hasArg(F("task")))
 	{
-		bool slow = td.flags & TaskDescriptor::SLOW;
+		if (!handleAuth(webServer))
+			return;
+
+		String command = webServer.arg(F("task")) + " " + webServer.arg(F("action"));
+		if (webServer.hasArg(F("ms")))
+			command += " " + webServer.arg(F("ms"));
+		controlTask(command);
 
-		//schedule(td.task);
+		//back to the plain page, a reload won't repeat the command
+		webServer.sendHeader("Location", String("/tasks"), true);
+		webServer.send(302, textPlain, "");
+		return;
+	}
+
+	StringStream ss(4096);
+	macroStringReplace(pageHeaderFS, constString(F("Tasks")), ss);
+	macroStringReplace(tasksPageHeaderFS, constString(String()), ss);
+
+	for (const auto& td: getTasks())
+	{
+		String flags;
+		if (td.flags & TaskDescriptor::CONNECTED) flags += 'C';
+		if (td.flags & TaskDescriptor::SLOW) flags += 'S';
+		if (td.flags & TaskDescriptor::TIME_SYNCED) flags += 'T';
+		if (td.flags & TaskDescriptor::FS_MOUNTED) flags += 'F';
+		if (td.flags & TaskDescriptor::SYSTEM) flags += 'Y';
 
-		if (!slow)
+		macroStringReplace(tasksPageRowFS, [&td, &flags](const char* key)
 		{
-			scheduleSingle(td.task);
-			continue;
-		}
+			String k(key);
+			if (k == F("name")) return td.name;
+			if (k == F("flags")) return flags;
+			if (k == F("state")) return String(stateName(td));
+			return taskStatistic(td, k);
+		}, ss);
+	}
+
+	macroStringReplace(tasksPageFooterFS, constString(String()), ss);
+	webServer.send(200, textHtml, ss.buffer);
+}
+
+//The tasks reading a configuration value only when they start (or connect).
+//The tasks subscribed to their keys (display brightness, messages, menu) and the
+//values read at every use (mqttReports, owmPeriod) are not here.
+struct ConfigOwner
+{
+	const char* key;
+	const char* task;		//reset, nullptr - the clock has to be restarted
+};
+
+static const ConfigOwner configOwners[] =
+{
+	{"segments", nullptr},			//the display geometry
+	{"rotation", nullptr},
+	{"lstSparkline", nullptr},		//a regular message
+	{"essid", "wifi"},
+	{"wifiPassword", "wifi"},
+	{"hostname", "wifi"},
+	{"timezone", "wifi"},
+	{"owmId", "owm"},
+	{"owmKey", "owm"},
+	{"mqttServer", "mqtt"},
+	{"mqttUser", "mqtt"},
+	{"mqttPassword", "mqtt"},
+	{"mqttClientId", "mqtt"},
+};
+
+static std::vector<String> pendingResets;
+static bool pendingReboot = false;
+static bool applyScheduled = false;
+
+//once after a reload, not for every key of it
+static void applyConfigChanges(void*)
+{
+	applyScheduled = false;
 
-		//it is slow but the token is there
-		if (td.task->getState() == Tasks::State::READY)
+	if (pendingReboot)
+	{
+		logPrintfX(F("TU"), F("The display or the task list changed, restarting..."));
+		rebootClock();
+	}
+	else
+	{
+		for (const auto& name: pendingResets)
 		{
-			//when it's ready and it can be executed now - do it!
-			if (slowTaskCanExecute)
-			{
-
-				//logPrintfX(F("TS"), F("Executing slow task..."));
-				td.task->run();
-				slowTaskCanExecute = false;
-				continue;
-			}
-
-			//otherwise delay by 0.1s
-			//logPrintfX(F("TS"), F("Delaying slow task execution..."));
-			td.task->sleep(0.1_s);
+			bool found = resetTask(name);
+			logPrintfX(F("TU"), F("Configuration of %s changed%s"), name.c_str(), found ? ", resetting": "");
 		}
 	}
+
+	pendingResets.clear();
+	pendingReboot = false;
+}
+
+static void configChanged(const String& key)
+{
+	const char* task = nullptr;
+
+	//"owmEnabled" - the tasks are created (and the trace enabled) at the start only
+	bool owned = key.endsWith(F("Enabled"));
+
+	for (size_t i = 0; i < sizeof(configOwners)/sizeof(configOwners[0]) && not owned; ++i)
+	{
+		owned = key == configOwners[i].key;
+		task = configOwners[i].task;
+	}
+
+	if (not owned)
+		return;
+
+	if (task == nullptr)
+		pendingReboot = true;
+	else if (std::find(pendingResets.begin(), pendingResets.end(), task) == pendingResets.end())
+		pendingResets.push_back(task);
+
+	if (not applyScheduled)
+	{
+		applyScheduled = true;
+		TimerService::getInstance().runAfter(0, applyConfigChanges);
+	}
+}
+
+void setupTasks()
+{
+	addSystemVariables();
+	Variables::addPrefix(F("task."), getTaskStatistic);
+	Variables::addPrefix(F("timers."), [](const String& name) {return TimerService::getInstance().getStatistic(name);});
+
+	addTask(&WifiConnector::getInstance(), TaskDescriptor::SYSTEM, F("wifi"));
+	addTask(&WebServerTask::getInstance(), TaskDescriptor::SYSTEM, F("web"));
+	addTask(&DisplayTask::getInstance(), TaskDescriptor::SYSTEM, F("display"));
+	addTask(&TimerService::getInstance(), TaskDescriptor::SYSTEM, F("timers"));
+
+	addTask(new SerialCommandTask, TaskDescriptor::SYSTEM, F("serial"));
+	addOptionalTask<LHCStatusReaderNew>(F("lhcEnabled"), TaskDescriptor::CONNECTED | TaskDescriptor::SLOW);
+	addOptionalTask<LEDBlinker>(F("ledEnabled"), 0);
+	addOptionalTask<WeatherGetter>(F("owmEnabled"), TaskDescriptor::SLOW | TaskDescriptor::CONNECTED);
+	addOptionalTask<MQTTTask>(F("mqttEnabled"), TaskDescriptor::CONNECTED);
+	addOptionalTask<LocalSensorTask>(F("lstEnabled"), TaskDescriptor::SLOW);
+	addOptionalTask<MessagesTask>(F("messagesEnabled"), TaskDescriptor::FS_MOUNTED | TaskDescriptor::TIME_SYNCED);
+	addOptionalTask<RestaurantMenuTask>(F("menuEnabled"), TaskDescriptor::SLOW | TaskDescriptor::CONNECTED | TaskDescriptor::TIME_SYNCED);
+
+	//called by SNTP, possibly in the middle of a task
+	settimeofday_cb([]() {openGateLater(TaskDescriptor::TIME_SYNCED);});
+
+	registerPage(F("tasks"), F("Tasks"), handleTasksPage);
+	Trace::init();
+	TimeSeries::init();
+
+	//the values read already, every later change goes to the task owning it
+	DataStore::subscribe(String(), configChanged);
+}
+
+template <class T>
+using TaskMemberWebCallback = void (T::*)(ESP8266WebServer&);
+
+template <class T>
+void registerPage(const String& url, const String& label, T* task, TaskMemberWebCallback<T> callback)
+{
+	WebServerTask::getInstance().registerPage(url, label,
+	[task, callback](ESP8266WebServer& ws) {task->*callback(ws);});
 }
 
 
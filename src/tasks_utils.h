@@ -13,19 +13,7 @@
 #include "WebServerTask.h"
 #include <DataStore.h>
 #include <DisplayTask.hpp>
-
-struct TaskDescriptor
-{
-		const static uint8_t ENABLED = 1;
-		const static uint8_t CONNECTED = 2;
-		const static uint8_t SLOW = 4;
-
-		TaskDescriptor(Tasks::Task* task, uint8_t flags):
-			task(task), flags(flags){}
-
-		Tasks::Task* task;
-		uint8_t flags;
-};
+#include "Scheduler.h"
 
 using PageCallback = std::function<void(ESP8266WebServer&, void*)>;
 
@@ -43,11 +31,6 @@ void addRegularMessage(const DisplayState& ds);
 
 void setupTasks();
 
-std::vector<TaskDescriptor>& getTasks();
-Tasks::Task* addTask(Tasks::Task* t, uint8_t flags = 0);
-void addTask(const TaskDescriptor& td);
-void scheduleTasks();
-
 template <class T>
 void addOptionalTask(const String& variableName, uint8_t flags)
 {
@@ -55,10 +38,19 @@ void addOptionalTask(const String& variableName, uint8_t flags)
 	if (not enabled)
 		return;
 
-	addTask(new T, flags);
+	//"owmEnabled" -> "owm"
+	String name = variableName;
+	if (name.endsWith(F("Enabled")))
+		name.remove(name.length() - 7);
+
+	addTask(new T, flags, name);
 }
 
-extern bool slowTaskCanExecute;
+//"<task> suspend|resume|period <ms>" from the web page, MQTT or serial, returns what was done
+String controlTask(const String& command);
+
+//statistics of a task as "<name>.<calls|total|avg|max|last|hist|late|latemax|missed|poll|pollgap|pollgapmax|period>", empty if unknown
+String getTaskStatistic(const String& name);
 
 
 #endif /* TASKS_UTILS_H_ */
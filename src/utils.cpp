@@ -8,6 +8,7 @@
 #include <stdio.h>
 
 #include <vector>
+#include <algorithm>
 #include <memory>
 #include <utility>
 #include <deque>
@@ -18,11 +19,15 @@
 #include "Arduino.h"
 #include "LittleFS.h"
 #include "DataStore.h"
+#include "ConfigSchema.h"
+#include "ConfigCache.h"
+#include "ConfigJournal.h"
 #include "WiFiUdp.h"
 #include "SyslogSender.h"
 #include "ESP8266WiFi.h"
 #include "tasks_utils.h"
-#include "LambdaTask.hpp"
+#include "TimerService.h"
+#include "Variables.h"
 #include <time_utils.h>
 #include <DisplayTask.hpp>
 
@@ -64,7 +69,7 @@ String getTime()
 
 	char localBuffer[10];
 
-	bool short_display = DataStore::value("segments").toInt() <= 4;
+	bool short_display = Config::getInt(Config::SEGMENTS) <= 4;
 
 	if (short_display)
 	{
@@ -105,7 +110,7 @@ String getDate()
 
 	char localBuffer[20];
 
-	static const auto day_names = DataStore::value("segments").toInt() < 5 ? short_day_names: long_day_names;
+	static const auto day_names = Config::getInt(Config::SEGMENTS) < 5 ? short_day_names: long_day_names;
 
 	auto lt = localtime(&now);
 	snprintf(localBuffer, sizeof(localBuffer), "%s %02d/%02d",
@@ -215,10 +220,16 @@ void limitToLatin1(char * p)
 bool checkFileSystem()
 {
 	bool alreadyFormatted = LittleFS.begin();
+	bool mounted = alreadyFormatted;
 	if (not alreadyFormatted)
-		LittleFS.format();
+		mounted = LittleFS.format() && LittleFS.begin();
 
 	LittleFS.end();
+
+	//the tasks keeping their data in files wait for this
+	if (mounted)
+		openGate(TaskDescriptor::FS_MOUNTED);
+
 	return alreadyFormatted;
 }
 
@@ -250,43 +261,76 @@ std::pair<String, String> splitLine(String& line)
     return result;
 }
 
+static uint32_t configLoadTime = 0;		//us
+static ConfigCache::Source configSource = ConfigCache::Source::NONE;
+
 void readConfigFromFS()
 {
+	uint32_t start = micros();
     logPrintfX("UTL", F("Reading configuration values from the flash..."));
-    //the FS has to be initialized already...
-	LittleFS.begin();
-    auto file = LittleFS.open("/config.txt", "r");
-    if (!file)
+
+	//only the changed values are stored again, the subscribers hear just about them;
+	//the readers see the old values till the new ones are published together
+	auto less = [](const String& a, const String& b) {return strcmp(a.c_str(), b.c_str()) < 0;};
+	std::vector<String> oldKeys = DataStore::availableKeys();
+	std::vector<String> newKeys;
+	DataStore::beginUpdate();
+
+	//the FS has to be initialized already...
+	configSource = ConfigCache::read([&newKeys](const DataStore::Key& key, const char* value)
+	{
+		DataStore::set(key, value);
+		newKeys.push_back(key.name);
+	});
+
+	//and the single values changed since the journal was merged into it
+	ConfigJournal::replay([&newKeys](const String& key, const String& value)
+	{
+		auto it = std::find(newKeys.begin(), newKeys.end(), key);
+		if (value.length())
+		{
+			DataStore::set(key, value);
+			if (it == newKeys.end())
+				newKeys.push_back(key);
+			return;
+		}
+
+		DataStore::erase(key);
+		if (it != newKeys.end())
+			newKeys.erase(it);
+	});
+
+	if (configSource == ConfigCache::Source::NONE)
 	{
 		logPrintfX(F("UTL"), F("The file is missing, please create your own config using the web interface!"));
+		DataStore::endUpdate();
+		Config::load();
 		return;
 	}
 
-	logPrintfX(F("UTL"), "File size: %zu", file.size());
+	//and the data that's not in the file any more is removed
+	std::sort(newKeys.begin(), newKeys.end(), less);
+	for (const auto& k: oldKeys)
+	{
+		if (!std::binary_search(newKeys.begin(), newKeys.end(), k, less))
+			DataStore::erase(k);
+	}
 
-	//remove all the data that's already present
-	DataStore::clear();
+	DataStore::endUpdate();
+	Config::load();
 
-    while (file.available())
-    {
-		String l = readLine(file);
-	    auto p = splitLine(l);
-        if (not p.second.length())
-            continue;
-
-        logPrintfX("UTL", F("Config: %s = '%s'"), p.first.c_str(), p.second.c_str());
-		DataStore::value(p.first) = p.second;
-    }
-	LittleFS.end();
+	configLoadTime = micros() - start;
+	logPrintfX(F("UTL"), F("%zu values read from the %s in %u us"), newKeys.size(),
+			configSource == ConfigCache::Source::IMAGE ? "image": "text", configLoadTime);
 }
 
 
-String readConfigWithDefault(const String& name, const String& def)
+String readConfigWithDefault(const DataStore::Key& name, const String& def)
 {
 	return DataStore::valueOrDefault(name, def);
 }
 
-String readConfig(const String& name)
+const String& readConfig(const DataStore::Key& name)
 {
 	return DataStore::value(name);
 }
@@ -303,53 +347,39 @@ String dataSource(const String& name_)
 
 String dataSourceWithDefault(const String& name_, const String& default_)
 {
-	String result;
+	//a lookup doesn't insert anything
+	const String& stored = DataStore::value(name_);
+	if (stored.length())
+		return stored;
 
-	String name = name_;
-	
-
-	if (DataStore::hasValue(name))
-	{
-		result = DataStore::value(name);
-		if (result)
-			return result;
-	}
-
-	name.toUpperCase();
-
-	if (name == F("IP"))
-		return WiFi.localIP().toString();
-
-	if (name ==  F("HEAP"))
-		return String(ESP.getFreeHeap()) + " B";
-
-	if (name == F("VERSION"))
-		return versionString;
-
-	if (name ==  F("BUILD"))
-		return __DATE__ " - " __TIME__;
-
-	if (name == F("ESSID"))
-		return WiFi.SSID();
+	String result;
+	if (Variables::get(name_, result))
+		return result;
 
-	if (name == F("MAC"))
-		return WiFi.macAddress();
+	return default_;
+}
 
-	if (name == F("UPTIME"))
+void addSystemVariables()
+{
+	Variables::addText(F("ip"), []() {return WiFi.localIP().toString();});
+	Variables::addInt(F("heap"), []() {return (int32_t)ESP.getFreeHeap();}, " B");
+	Variables::addText(F("version"), []() {return String(versionString);});
+	Variables::addText(F("build"), []() {return String(F(__DATE__ " - " __TIME__));});
+	Variables::addText(F("essid"), []() {return WiFi.SSID();});
+	Variables::addText(F("mac"), []() {return WiFi.macAddress();});
+	Variables::addText(F("configLoad"), []()
 	{
-		return formatDeltaTime(getUpTime(), DeltaTimePrecision::SECONDS);
-	}
-
-	return default_;
+		const char* source = configSource == ConfigCache::Source::IMAGE ? "image": configSource == ConfigCache::Source::TEXT ? "text": "none";
+		return String(configLoadTime / 1000.0, 1) + " ms (" + source + ")";
+	});
+	Variables::addText(F("uptime"), []() {return formatDeltaTime(getUpTime(), DeltaTimePrecision::SECONDS);});
 }
 
 void rebootClock()
 {
 	DisplayTask::getInstance().pushMessage("Rebooting...", 5_s, false);
 	logPrintfX(F("WS"), F("Rebooting in 5 seconds..."));
-	LambdaTask* lt = new LambdaTask([](){ESP.restart();});
-	addTask(lt, TaskDescriptor::ENABLED);
-	lt->sleep(5_s);
+	TimerService::getInstance().runAfter(5000, [](void*){ESP.restart();});
 }
 
 String readLine(fs::File& file)
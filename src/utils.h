@@ -11,10 +11,12 @@
 #include <string>
 #include "pgmspace.h"
 #include <deque>
+#include "DataStore.h"
 
 extern int32_t timezone;
 class String;
 
+//ticks of MS_PER_CYCLE for Task::sleep, 655 s at most - use sleepFor for longer
 uint16_t operator"" _s(long double seconds);
 uint16_t operator"" _s(unsigned long long int seconds);
 
@@ -36,11 +38,13 @@ void limitToLatin1(char * s);
 // Configuration helpers
 void readConfigFromFS();
 bool checkFileSystem();
-String readConfigWithDefault(const String& name, const String& def);
-String readConfig(const String& name);
+String readConfigWithDefault(const DataStore::Key& name, const String& def);
+const String& readConfig(const DataStore::Key& name);
 
 String dataSource(const String& name_);
 String dataSourceWithDefault(const String& name_, const String& default_);
+//ip, heap, version, build, essid, mac, configLoad and uptime
+void addSystemVariables();
 
 namespace fs
 {
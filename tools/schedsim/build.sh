@@ -0,0 +1,6 @@
+#!/bin/sh
+# Builds the host simulation of the scheduler: ./build.sh && ./schedsim 24
+cd "$(dirname "$0")"
+exec g++ -std=c++11 -O2 -Wall -Ishim -I../../src \
+	sim.cpp ../../src/Scheduler.cpp ../../src/AdaptivePoll.cpp \
+	-o schedsim
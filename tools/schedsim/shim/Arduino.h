@@ -0,0 +1,68 @@
+/*
+ * Arduino.h - host shim for the scheduler simulation
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef SCHEDSIM_ARDUINO_H_
+#define SCHEDSIM_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#define IRAM_ATTR
+#define PROGMEM
+#define F(s) (s)
+
+//pins used by config.h
+const static uint8_t D2 = 4;
+const static uint8_t D3 = 0;
+const static uint8_t D4 = 2;
+const static uint8_t D8 = 15;
+
+//just enough of String for the scheduler
+class String
+{
+	public:
+		String() {}
+		String(const char* s): s(s) {}
+		String(const std::string& s): s(s) {}
+
+		size_t length() const {return s.length();}
+		const char* c_str() const {return s.c_str();}
+		bool operator==(const String& o) const {return s == o.s;}
+		bool operator==(const char* o) const {return s == o;}
+
+	private:
+		std::string s;
+};
+
+//the virtual clock, advanced by the simulated work and by delay()
+namespace Sim
+{
+	extern uint64_t clock;			//us
+	extern uint64_t idle;			//us spent in delay()
+	const static uint32_t CPU_MHZ = 80;
+}
+
+inline uint64_t micros64() {return Sim::clock;}
+inline uint32_t micros() {return Sim::clock;}
+inline uint32_t millis() {return Sim::clock / 1000;}
+
+inline void delay(uint32_t ms)
+{
+	Sim::clock += ms * 1000ULL;
+	Sim::idle += ms * 1000ULL;
+}
+
+struct EspClass
+{
+	uint32_t getCycleCount() {return Sim::clock * Sim::CPU_MHZ;}
+	uint8_t getCpuFreqMHz() {return Sim::CPU_MHZ;}
+};
+
+extern EspClass ESP;
+
+#endif /* SCHEDSIM_ARDUINO_H_ */
@@ -0,0 +1,57 @@
+/*
+ * tasks.hpp - host shim of the CPPTasks API used by the scheduler
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ */
+
+#ifndef SCHEDSIM_TASKS_HPP_
+#define SCHEDSIM_TASKS_HPP_
+
+#include <stdint.h>
+
+namespace Tasks
+{
+	enum class State
+	{
+		READY,
+		SLEEPING,
+		SUSPENDED,
+		KILLED
+	};
+
+	class Task
+	{
+		public:
+			virtual ~Task() = default;
+			virtual void run() = 0;
+			virtual void reset() {}
+
+			void sleep(uint16_t ticks)
+			{
+				if (state == State::KILLED)
+					return;
+				sleepTicks = ticks;
+				state = ticks ? State::SLEEPING: State::READY;
+			}
+
+			void suspend() {if (state != State::KILLED) state = State::SUSPENDED;}
+			void resume() {if (state != State::KILLED) state = State::READY;}
+			void kill() {state = State::KILLED;}
+			State getState() const {return state;}
+
+			friend void updateSleepSingle(Task* t);
+
+		private:
+			State state = State::READY;
+			uint16_t sleepTicks = 0;
+	};
+
+	inline void updateSleepSingle(Task* t)
+	{
+		if (t->state == State::SLEEPING && --t->sleepTicks == 0)
+			t->state = State::READY;
+	}
+}
+
+#endif /* SCHEDSIM_TASKS_HPP_ */
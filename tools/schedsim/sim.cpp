@@ -0,0 +1,435 @@
+/*
+ * sim.cpp - replays the scheduler on a virtual clock
+ *
+ *  Created on: 18.10.2026
+ *      Author: Bauke Spoelstra
+ *
+ * The scheduler (src/Scheduler.cpp) and AdaptivePoll are the real ones, the
+ * tasks are models that only spend virtual time the way the real ones do:
+ * SPI refreshes of the display, blocking HTTP/TLS fetches, file accesses,
+ * requests arriving at the web server and the MQTT broker.
+ *
+ * Usage: schedsim [hours] [seed]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "Arduino.h"
+#include "Scheduler.h"
+#include "AdaptivePoll.h"
+#include "TraceRecorder.h"
+#include "StallWatchdog.h"
+#include "config.h"
+
+uint64_t Sim::clock = 0;
+uint64_t Sim::idle = 0;
+EspClass ESP;
+
+//the parts of the trace recorder and the watchdog the scheduler touches
+bool Trace::enabled = false;
+volatile uint16_t Trace::activeIds[Trace::MAX_DEPTH];
+volatile uint8_t Trace::activeDepth = 0;
+uint16_t Trace::registerName(const String&) {return 0;}
+void Trace::recordEvent(uint16_t, Type) {}
+
+volatile uint32_t StallWatchdog::ticksSinceFeed = 0;
+volatile uint16_t StallWatchdog::currentTask = StallWatchdog::NO_TASK;
+
+//the same as in utils.cpp
+static uint16_t operator"" _s(unsigned long long int seconds) {return seconds * 1000 / MS_PER_CYCLE;}
+
+//mt19937 is fully specified, the results are the same everywhere for the same seed
+static std::mt19937 rng;
+
+static uint32_t uniform(uint32_t from, uint32_t to)
+{
+	return from + rng() % (to - from + 1);
+}
+
+static uint64_t exponential(double mean)
+{
+	double u = (rng() + 0.5) / 4294967296.0;
+	return -mean * std::log(u);
+}
+
+struct Samples
+{
+	std::vector<int64_t> values;
+
+	void add(int64_t v) {values.push_back(v);}
+
+	int64_t percentile(double p)
+	{
+		if (values.empty())
+			return 0;
+		size_t n = std::min(values.size() - 1, (size_t)(p * values.size()));
+		std::nth_element(values.begin(), values.begin() + n, values.end());
+		return values[n];
+	}
+
+	double mean() const
+	{
+		double sum = 0;
+		for (auto v: values)
+			sum += v;
+		return values.empty() ? 0: sum / values.size();
+	}
+};
+
+class SimTask: public Tasks::Task
+{
+	public:
+		SimTask(const char* name): name(name) {}
+
+		virtual void run()
+		{
+			//how long after its deadline it started
+			for (const auto& td: getTasks())
+			{
+				if (td.task == this)
+					wait.add(Sim::clock - td.wakeUp);
+			}
+			step();
+		}
+
+		const char* name;
+		uint64_t busyUs = 0;
+		Samples wait;			//us
+		Samples latency;		//us, input waiting for the task (web, MQTT)
+
+	protected:
+		virtual void step() = 0;
+
+		//blocking work - the whole loop waits
+		void busy(uint64_t us)
+		{
+			Sim::clock += us;
+			busyUs += us;
+		}
+};
+
+//DisplayTask: the time refreshed every second, then a scrolled message
+class Display: public SimTask
+{
+	public:
+		Display(): SimTask("display") {}
+
+		Samples jitter;				//us, start-to-start minus the requested sleep
+		Samples scrollJitter;
+
+	protected:
+		virtual void step()
+		{
+			if (lastStart)
+			{
+				int64_t j = (int64_t)(Sim::clock - lastStart) - requested;
+				jitter.add(j);
+				if (scrolling)
+					scrollJitter.add(j);
+			}
+			lastStart = Sim::clock;
+
+			if (column == 0 && refreshes < 10)
+			{
+				//the clock, the display is still till the next refresh
+				busy(uniform(250, 400));
+				refreshes++;
+				announceIdleWindow(1000);
+				sleepTicks(1_s);
+				return;
+			}
+
+			//a message of 300 columns, 30 ms per column, dwell at both ends
+			busy(uniform(300, 450));
+			scrolling = true;
+			column++;
+			if (column == 1 || column == 300)
+				announceIdleWindow(200);
+
+			if (column == 300)
+			{
+				column = 0;
+				refreshes = 0;
+				scrolling = false;
+			}
+			sleepTicks(3);
+		}
+
+	private:
+		void sleepTicks(uint16_t ticks)
+		{
+			requested = ticks * MS_PER_CYCLE * 1000;
+			sleep(ticks);
+		}
+
+		uint64_t lastStart = 0;
+		int64_t requested = 0;
+		uint16_t column = 0;
+		uint8_t refreshes = 0;
+		bool scrolling = false;
+};
+
+//web server, MQTT and serial: polled with AdaptivePoll, input arrives at random
+class Poller: public SimTask
+{
+	public:
+		Poller(const char* name, uint16_t minInterval, uint16_t maxInterval,
+				uint32_t pollCost, double meanArrival, uint32_t handleMin, uint32_t handleMax):
+			SimTask(name),
+			poll(this, minInterval, maxInterval),
+			pollCost(pollCost),
+			meanArrival(meanArrival),
+			handleMin(handleMin),
+			handleMax(handleMax)
+		{
+			arrival = exponential(meanArrival);
+		}
+
+	protected:
+		virtual void step()
+		{
+			busy(pollCost);
+
+			bool activity = arrival <= Sim::clock;
+			if (activity)
+			{
+				latency.add(Sim::clock - arrival);
+				busy(uniform(handleMin, handleMax));
+				arrival = Sim::clock + exponential(meanArrival);
+			}
+
+			sleepFor(this, poll.next(activity));
+		}
+
+	private:
+		AdaptivePoll poll;
+		uint32_t pollCost;
+		double meanArrival;
+		uint32_t handleMin;
+		uint32_t handleMax;
+		uint64_t arrival;
+};
+
+//WeatherGetter: connects (blocking), then awaits the response in 10 ms polls
+class Weather: public SimTask
+{
+	public:
+		Weather(): SimTask("owm") {}
+
+	protected:
+		virtual void step()
+		{
+			if (dataAt == 0)
+			{
+				busy(uniform(80000, 300000));
+				dataAt = Sim::clock + uniform(200000, 1500000);
+			}
+
+			//the polls of the await don't wait for an idle window
+			if (Sim::clock < dataAt)
+			{
+				sleepFor(this, CO_POLL);
+				nextRunIsShort(this);
+				return;
+			}
+
+			busy(uniform(10000, 25000));
+			dataAt = 0;
+
+			//current weather and the forecast for every location
+			if (++request % 2)
+			{
+				sleep(0);
+				return;
+			}
+
+			if (request < 6)
+			{
+				sleep(5_s);
+				return;
+			}
+
+			request = 0;
+			sleepFor(this, 600000);
+		}
+
+	private:
+		const static uint32_t CO_POLL = 10;
+		uint64_t dataAt = 0;
+		uint8_t request = 0;
+};
+
+//blocking fetchers and readers with a fixed period
+class Blocking: public SimTask
+{
+	public:
+		Blocking(const char* name, uint32_t costMin, uint32_t costMax, uint32_t period, bool periodic):
+			SimTask(name), costMin(costMin), costMax(costMax), period(period), periodic(periodic) {}
+
+	protected:
+		virtual void step()
+		{
+			busy(uniform(costMin, costMax));
+			if (periodic)
+				sleepPeriodic(this, period);
+			else
+				sleepFor(this, period);
+		}
+
+	private:
+		uint32_t costMin;
+		uint32_t costMax;
+		uint32_t period;
+		bool periodic;
+};
+
+//coroutine fetchers (menu, LHC): a blocking TLS connect, then the response
+//read and parsed in short steps as its pieces arrive
+class Fetcher: public SimTask
+{
+	public:
+		Fetcher(const char* name, uint32_t connectMin, uint32_t connectMax, uint8_t pieces,
+				uint32_t pieceMin, uint32_t pieceMax, uint32_t period, bool periodic):
+			SimTask(name), connectMin(connectMin), connectMax(connectMax), pieces(pieces),
+			pieceMin(pieceMin), pieceMax(pieceMax), period(period), periodic(periodic) {}
+
+	protected:
+		virtual void step()
+		{
+			if (piece == 0)
+			{
+				busy(uniform(connectMin, connectMax));
+				piece = 1;
+				dataAt = Sim::clock + uniform(20000, 300000);
+			}
+
+			if (Sim::clock < dataAt)
+			{
+				sleepFor(this, CO_POLL);
+				nextRunIsShort(this);
+				return;
+			}
+
+			busy(uniform(pieceMin, pieceMax));
+			if (piece++ < pieces)
+			{
+				dataAt = Sim::clock + uniform(20000, 300000);
+				sleepFor(this, CO_POLL);
+				nextRunIsShort(this);
+				return;
+			}
+
+			piece = 0;
+			if (periodic)
+				sleepPeriodic(this, period);
+			else
+				sleepFor(this, period);
+		}
+
+	private:
+		const static uint32_t CO_POLL = 10;
+		uint32_t connectMin;
+		uint32_t connectMax;
+		uint8_t pieces;
+		uint32_t pieceMin;
+		uint32_t pieceMax;
+		uint32_t period;
+		bool periodic;
+		uint8_t piece = 0;
+		uint64_t dataAt = 0;
+};
+
+static void printSamples(const char* name, Samples& s, double unit)
+{
+	printf("  %-14s n=%-9zu mean %9.2f  p50 %9.2f  p99 %9.2f  max %9.2f\n", name, s.values.size(),
+			s.mean() / unit, s.percentile(0.5) / unit, s.percentile(0.99) / unit, s.percentile(1.0) / unit);
+}
+
+int main(int argc, char** argv)
+{
+	double hours = argc > 1 ? atof(argv[1]): 24;
+	uint32_t seed = argc > 2 ? atoi(argv[2]): 1;
+	rng.seed(seed);
+
+	Display display;
+	Poller web("web", WEB_POLL_MIN, WEB_POLL_MAX, 40, 300e6, 20000, 80000);
+	Poller mqtt("mqtt", MQTT_POLL_MIN, MQTT_POLL_MAX, 80, 120e6, 2000, 5000);
+	Poller serial("serial", SERIAL_POLL_MIN, SERIAL_POLL_MAX, 10, 3600e6, 500, 1000);
+	Blocking wifi("wifi", 50, 150, 10000, false);
+	Weather owm;
+	Fetcher menu("menu", 500000, 950000, 12, 5000, 20000, 900000, true);
+	Fetcher lhc("lhc", 400000, 800000, 6, 1000, 40000, 60000, false);
+	Blocking messages("messages", 5000, 20000, 60000, true);
+	Blocking lst("lst", 12000, 30000, 30000, true);
+
+	std::vector<SimTask*> tasks = {&display, &web, &mqtt, &serial, &wifi, &owm, &menu, &lhc, &messages, &lst};
+
+	addTask(&wifi, 0, "wifi");
+	addTask(&web, 0, "web");
+	addTask(&display, 0, "display");
+	addTask(&serial, 0, "serial");
+	addTask(&lhc, TaskDescriptor::CONNECTED | TaskDescriptor::SLOW, "lhc");
+	addTask(&owm, TaskDescriptor::SLOW | TaskDescriptor::CONNECTED, "owm");
+	addTask(&mqtt, TaskDescriptor::CONNECTED, "mqtt");
+	addTask(&lst, TaskDescriptor::SLOW, "lst");
+	addTask(&messages, TaskDescriptor::FS_MOUNTED | TaskDescriptor::TIME_SYNCED, "messages");
+	addTask(&menu, TaskDescriptor::SLOW | TaskDescriptor::CONNECTED | TaskDescriptor::TIME_SYNCED, "menu");
+
+	//the file system at once, the network after 4 s and the time 2 s later
+	openGate(TaskDescriptor::FS_MOUNTED);
+	bool connected = false, synced = false;
+
+	uint64_t end = hours * 3600e6;
+	uint64_t passes = 0;
+	clock_t started = std::clock();
+
+	while (Sim::clock < end)
+	{
+		if (!connected && Sim::clock >= 4000000)
+		{
+			openGate(TaskDescriptor::CONNECTED);
+			connected = true;
+		}
+
+		if (!synced && Sim::clock >= 6000000)
+		{
+			openGateLater(TaskDescriptor::TIME_SYNCED);
+			synced = true;
+		}
+
+		//loop() itself
+		StallWatchdog::feed();
+		Sim::clock += 5;
+		scheduleTasks();
+		idleUntilNextTask(MAX_IDLE_MS);
+		passes++;
+	}
+
+	double seconds = (double)(std::clock() - started) / CLOCKS_PER_SEC;
+	printf("Simulated %.1f h (seed %u) in %.2f s, %llu loop passes, idle %.1f%%\n\n", hours, seed, seconds,
+			(unsigned long long)passes, 100.0 * Sim::idle / Sim::clock);
+
+	printf("Display tick jitter [ms]\n");
+	printSamples("all", display.jitter, 1000);
+	printSamples("scrolling", display.scrollJitter, 1000);
+
+	printf("\nStart past the deadline [ms]\n");
+	for (auto t: tasks)
+		printSamples(t->name, t->wait, 1000);
+
+	printf("\nInput waiting for the poll [ms]\n");
+	for (auto t: {&web, &mqtt, &serial})
+		printSamples(t->name, t->latency, 1000);
+
+	printf("\nCPU share\n");
+	for (auto t: tasks)
+		printf("  %-14s %8.4f%%  %llu runs\n", t->name, 100.0 * t->busyUs / Sim::clock, (unsigned long long)t->wait.values.size());
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""Converts the binary dump from /trace.bin into the Chrome/Perfetto trace format.
+
+Usage: trace2json.py trace.bin > trace.json
+"""
+
+import json
+import struct
+import sys
+
+MAGIC = 0x31435254
+
+
+def convert(data):
+    magic, mhz, count, name_count = struct.unpack_from("<4I", data, 0)
+    if magic != MAGIC:
+        raise ValueError("not a trace dump")
+
+    offset = 16
+    names = []
+    for _ in range(name_count):
+        length = data[offset]
+        names.append(data[offset + 1:offset + 1 + length].decode("latin-1"))
+        offset += 1 + length
+
+    events = []
+    cycles = 0
+    previous = None
+    for _ in range(count):
+        raw, event_id, event_type, _reserved = struct.unpack_from("<IHBB", data, offset)
+        offset += 8
+
+        # unwrap the 32-bit cycle counter
+        if previous is not None:
+            cycles += (raw - previous) & 0xFFFFFFFF
+        previous = raw
+
+        name = names[event_id] if event_id < len(names) else "?"
+        events.append({
+            "name": name,
+            "ph": "BEi"[event_type],
+            "ts": cycles / mhz,
+            "pid": 1,
+            "tid": 1,
+        })
+
+    return {"displayTimeUnit": "ms", "traceEvents": events}
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+
+    with open(sys.argv[1], "rb") as f:
+        json.dump(convert(f.read()), sys.stdout, indent=1)
+
+
+if __name__ == "__main__":
+    main()